@@ -0,0 +1,262 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: bench.c, accuracy benchmark of the substitution solver.
+ * 		Excerpts of the samples are encrypted with random keys and
+ * 		solved with every search configuration, the same excerpts
+ * 		and keys for all of them.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "sweep.h"
+#include "pattern.h"
+#include "counts.h"
+#include "detect.h"
+#include "bench.h"
+
+static const Config configs[] = {
+	{"first",			FIRST_IMPROVEMENT,	0,	0},
+	{"best",			BEST_IMPROVEMENT,	0,	0},
+	{"first+patterns",		FIRST_IMPROVEMENT,	1,	0},
+	{"first+words",			FIRST_IMPROVEMENT,	0,	1},
+	{"first+patterns+words",	FIRST_IMPROVEMENT,	1,	1},
+};
+
+#define NCONFIGS	((int)(sizeof(configs) / sizeof(Config)))
+
+/* function implementations */
+int
+parse_lengths(const char *s, long *lengths) {
+	char *end;
+	int n = 0;
+
+	while(*s) {
+		if(n == BENCH_MAXLENGTHS)
+			return -1;
+		lengths[n] = strtol(s, &end, 10);
+		if(end == s || lengths[n] < 1 || (*end != ',' && *end != '\0'))
+			return -1;
+		n++;
+		s = *end == ',' ? end+1 : end;
+	}
+
+	return n;
+}
+
+/* every sample but the model, lowercased like a cipher would be */
+static int
+load_texts(char **model, Text **texts) {
+	const gchar *name;
+	gchar *path;
+	GDir *d;
+	FILE *f;
+	Text *t = NULL;
+	long i;
+	int n = 0;
+
+	if((d = g_dir_open(SAMPLES_DIR, 0, NULL)) == NULL)
+		return 0;
+	while((name = g_dir_read_name(d)) != NULL) {
+		path = g_build_filename(SAMPLES_DIR, name, NULL);
+		if(in_model(model, path)) {
+			g_free(path);
+			continue;
+		}
+		f = fopen(path, "r");
+		g_free(path);
+		if(f == NULL)
+			continue;
+		t = realloc(t, (n+1) * sizeof(Text));
+		fseek(f, 0, SEEK_END);
+		t[n].len = ftell(f);
+		rewind(f);
+		t[n].text = malloc(t[n].len + 1);
+		t[n].len = fread(t[n].text, 1, t[n].len, f);
+		fclose(f);
+		for(i=0; i<t[n].len; i++)
+			t[n].text[i] = tolower((unsigned char)t[n].text[i]);
+		n++;
+	}
+	g_dir_close(d);
+	*texts = t;
+
+	return n;
+}
+
+/* an excerpt starting on a word, encrypted with a random key */
+static long
+make_excerpt(Text *t, int n, long len, GRand *rand, char *plain, char *cipher) {
+	char perm[KEYSIZE], c;
+	long start, i, j;
+	int k, x;
+
+	for(k=0, x=0; k<n; k++)
+		x += t[k].len > len;
+	if(x == 0)
+		return 0;
+	x = g_rand_int_range(rand, 0, x);
+	for(k=0; t[k].len <= len || x-- > 0; k++)
+		;
+	start = g_rand_int_range(rand, 0, t[k].len - len);
+	while(start > 0 && start < t[k].len - len && !isspace((unsigned char)t[k].text[start-1]))
+		start++;
+	len = len < t[k].len - start ? len : t[k].len - start;
+	for(i=0; i<KEYSIZE; i++)
+		perm[i] = i+OFFSET;
+	for(i=KEYSIZE-1; i>0; i--) {
+		j = g_rand_int_range(rand, 0, i+1);
+		c = perm[i];
+		perm[i] = perm[j];
+		perm[j] = c;
+	}
+	for(i=0; i<len; i++) {
+		plain[i] = t[k].text[start+i];
+		cipher[i] = islower((unsigned char)plain[i]) ? perm[plain[i]-OFFSET] : plain[i];
+	}
+
+	return len;
+}
+
+static void
+solve(const Config *cfg, FILE *f, Model *model, PatternIndex *idx, GList *slist, Search *search,
+		const char *plain, const char *cipher, long len, Trial *t) {
+	Search s = *search;
+	Budget budget;
+	char key[KEYSIZE], map[KEYSIZE], dec[KEYSIZE];
+	gint64 start;
+	long i, ok = 0, letters = 0;
+
+	s.policy = cfg->policy;
+	/* random keys, nothing is known about them */
+	memset(s.fixed, 0, KEYSIZE);
+	memset(map, 0, KEYSIZE);
+	budget_begin(&budget, s.time_limit, s.max_evals);
+	start = g_get_monotonic_time();
+	guess_key(f, key);
+	if(cfg->patterns) {
+		solve_patterns(idx, f, map);
+		seed_key(map, model->ks, key, NULL);
+	}
+	climb_ngrams(f, model, key, &s, &budget, 0);
+	if(cfg->words && !budget_exhausted(&budget))
+		climb_words(f, model->ks, slist, key, &s, &budget, 0);
+	t->secs = (g_get_monotonic_time() - start) / 1e6;
+	t->stopped = budget.stopped == STOP_SIGNAL;
+	budget_end(&budget);
+
+	/* decrypt_to_file() turns ks[i] into key[i] */
+	for(i=0; i<KEYSIZE; i++)
+		dec[model->ks[i]-OFFSET] = key[i];
+	for(i=0; i<len; i++)
+		if(islower((unsigned char)plain[i])) {
+			letters++;
+			ok += dec[cipher[i]-OFFSET] == plain[i];
+		}
+	t->accuracy = letters ? (double)ok / letters : 1;
+	/* letters missing from the excerpt cannot be told apart */
+	t->solved = ok == letters;
+}
+
+static int
+by_secs(const void *x, const void *y) {
+	double a = ((const Trial *)x)->secs, b = ((const Trial *)y)->secs;
+
+	return a < b ? -1 : a > b;
+}
+
+static void
+print_bucket(const Config *cfg, long len, Trial *t, int n) {
+	double accuracy = 0;
+	int i, solved = 0;
+
+	if(n == 0)
+		return;
+	for(i=0; i<n; i++) {
+		accuracy += t[i].accuracy;
+		solved += t[i].solved;
+	}
+	qsort(t, n, sizeof(Trial), by_secs);
+	/* nearest rank percentiles */
+	printf("%-24s | %7ld | %6d | %8.2f%% | %8.2f%% | %10.3f | %10.3f |\n", cfg->name, len, n,
+		100 * accuracy / n, 100.0 * solved / n, t[(n-1) / 2].secs, t[(99*n + 99) / 100 - 1].secs);
+}
+
+int
+bench_decrypt(FILE *fs, const char *sample, Search *search, const char *lengths, int trials) {
+	long len[BENCH_MAXLENGTHS];
+	char *plain, *cipher, **files;
+	Text *texts;
+	Trial *t[NCONFIGS];
+	Model *model;
+	PatternIndex *idx;
+	GList *slist;
+	GRand *rand;
+	FILE *f;
+	int i, j, k, c, nlen, ntexts, done, stopped = 0;
+	long l, maxlen = 0;
+
+	if((nlen = parse_lengths(lengths, len)) <= 0)
+		return -1;
+	for(i=0; i<nlen; i++)
+		maxlen = len[i] > maxlen ? len[i] : maxlen;
+	/* every file of a -m list or directory is part of the model */
+	files = sample_files(sample);
+	ntexts = load_texts(files, &texts);
+	g_strfreev(files);
+	if(ntexts == 0) {
+		fprintf(stderr, "No samples to take excerpts from.\n");
+		return 0;
+	}
+	model = model_new(fs);
+	idx = pattern_index_new(fs);
+	slist = sample_words(fs);
+	plain = malloc(maxlen);
+	cipher = malloc(maxlen);
+	for(c=0; c<NCONFIGS; c++)
+		t[c] = malloc(trials * sizeof(Trial));
+	/* random excerpts and keys, the same on every run */
+	rand = g_rand_new_with_seed(1);
+	printf("%-24s | %7s | %6s | %9s | %9s | %10s | %10s |\n%s\n", "Configuration", "Length", "Trials",
+		"Symbols", "Keys", "Median s", "p99 s",
+		"-------------------------------------------------------------------------------------------------");
+	for(i=0; i<nlen && !stopped; i++) {
+		for(j=0, done=0; j<trials && !stopped; j++) {
+			if((l = make_excerpt(texts, ntexts, len[i], rand, plain, cipher)) == 0)
+				break;
+			f = tmpfile();
+			fwrite(cipher, 1, l, f);
+			for(c=0; c<NCONFIGS && !stopped; c++) {
+				solve(&configs[c], f, model, idx, slist, search, plain, cipher, l, &t[c][j]);
+				stopped = t[c][j].stopped;
+			}
+			fclose(f);
+			done += !stopped;
+		}
+		if(j == 0 && !stopped)
+			fprintf(stderr, "No sample is longer than %ld characters.\n", len[i]);
+		for(c=0; c<NCONFIGS; c++)
+			print_bucket(&configs[c], len[i], t[c], done);
+		if(done > 0 && i < nlen-1)
+			printf("%24s | %7s | %6s | %9s | %9s | %10s | %10s |\n", "", "", "", "", "", "", "");
+	}
+	g_rand_free(rand);
+	for(c=0; c<NCONFIGS; c++)
+		free(t[c]);
+	free(plain);
+	free(cipher);
+	free_list(slist);
+	pattern_index_free(idx);
+	model_free(model);
+	for(k=0; k<ntexts; k++)
+		free(texts[k].text);
+	free(texts);
+
+	return nlen;
+}
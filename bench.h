@@ -0,0 +1,34 @@
+/*
+ * Description: bench.h, header file for bench.c
+ */
+
+#include <glib.h>
+
+/* excerpt lengths in characters and excerpts per length, by default */
+#define BENCH_LENGTHS	"100,200,400,800,1600"
+#define BENCH_TRIALS	10
+#define BENCH_MAXLENGTHS	32
+
+/* structs */
+typedef struct {
+	const char *name;
+	int policy;
+	int patterns;
+	int words;
+} Config;
+
+typedef struct {
+	double accuracy;
+	int solved;
+	double secs;
+	int stopped;
+} Trial;
+
+typedef struct {
+	char *text;
+	long len;
+} Text;
+
+/* function declarations */
+int parse_lengths(const char *s, long *lengths);
+int bench_decrypt(FILE *fs, const char *sample, Search *search, const char *lengths, int trials);
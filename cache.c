@@ -0,0 +1,98 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: cache.c, bounded score cache for the key search. Keys are
+ * 		hashed Zobrist style, so the hash of a key with two positions
+ * 		swapped is derived from the current one in constant time.
+ */
+
+#include <stdlib.h>
+#include "cache.h"
+
+#define SYMBOLS	256
+
+/* function implementations */
+static guint64
+splitmix(guint64 *x) {
+	guint64 z = (*x += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+Cache *
+cache_new(int keysize, int bits) {
+	Cache *c;
+	guint64 seed = 0x636861726d6170ULL;
+	int i;
+
+	c = malloc(sizeof(Cache));
+	c->keysize = keysize;
+	/* fixed seed, runs are reproducible */
+	c->zobrist = malloc(keysize * SYMBOLS * sizeof(guint64));
+	for(i=0; i<keysize*SYMBOLS; i++)
+		c->zobrist[i] = splitmix(&seed);
+	c->slots = calloc((size_t)1 << bits, sizeof(Slot));
+	c->mask = ((guint64)1 << bits) - 1;
+	c->hits = 0;
+	c->misses = 0;
+
+	return c;
+}
+
+static guint64
+zobrist(Cache *c, int pos, char symbol) {
+	return c->zobrist[pos * SYMBOLS + (unsigned char)symbol];
+}
+
+guint64
+cache_hash(Cache *c, const char *key) {
+	guint64 hash = 0;
+	int i;
+
+	for(i=0; i<c->keysize; i++)
+		hash ^= zobrist(c, i, key[i]);
+
+	return hash;
+}
+
+guint64
+cache_swap(Cache *c, guint64 hash, const char *key, int a, int b) {
+	/* take both symbols out of their position and put them back swapped */
+	return hash ^ zobrist(c, a, key[a]) ^ zobrist(c, b, key[b])
+		^ zobrist(c, a, key[b]) ^ zobrist(c, b, key[a]);
+}
+
+int
+cache_lookup(Cache *c, guint64 hash, double *score) {
+	Slot *s = &c->slots[hash & c->mask];
+
+	/* an empty slot has hash 0, which no real key is expected to hit */
+	if(hash && s->hash == hash) {
+		*score = s->score;
+		c->hits++;
+		return 1;
+	}
+	c->misses++;
+
+	return 0;
+}
+
+void
+cache_store(Cache *c, guint64 hash, double score) {
+	Slot *s = &c->slots[hash & c->mask];
+
+	/* direct mapped, the newest score always wins the slot */
+	s->hash = hash;
+	s->score = score;
+}
+
+void
+cache_free(Cache *c) {
+	free(c->zobrist);
+	free(c->slots);
+	free(c);
+}
@@ -0,0 +1,32 @@
+/*
+ * Description: cache.h, header file for cache.c
+ */
+
+#include <glib.h>
+
+/* log2 of the number of slots of a score cache */
+#define CACHE_BITS	16
+
+/* structs */
+typedef struct {
+	guint64 hash;
+	double score;
+} Slot;
+
+typedef struct Cache {
+	int keysize;
+	/* one random word for every (position, symbol) pair */
+	guint64 *zobrist;
+	Slot *slots;
+	guint64 mask;
+	long hits;
+	long misses;
+} Cache;
+
+/* function declarations */
+Cache *cache_new(int keysize, int bits);
+guint64 cache_hash(Cache *c, const char *key);
+guint64 cache_swap(Cache *c, guint64 hash, const char *key, int a, int b);
+int cache_lookup(Cache *c, guint64 hash, double *score);
+void cache_store(Cache *c, guint64 hash, double score);
+void cache_free(Cache *c);
@@ -17,6 +17,17 @@
 #include "charemap.h"
 #include "decrypt.h"
 #include "utils.h"
+#include "sweep.h"
+#include "pattern.h"
+#include "detect.h"
+#include "vigenere.h"
+#include "source.h"
+#include "counts.h"
+#include "window.h"
+#include "bench.h"
+#include "crib.h"
+#include "remap.h"
+#include "progressive.h"
 
 /* function implementations */
 void
@@ -28,7 +39,7 @@ die(const char *errstr) {
 void
 usage() {
 	printf("Usage: charemap [options]...\nOptions:\n");
-	printf("  %-15s %s\n  %-15s %s\n  %-15s %s\n                  %s\n                  %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n",
+	printf("  %-15s %s\n  %-15s %s\n  %-15s %s\n                  %s\n                  %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n                  %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n  %-15s %s\n",
 		"-h",		"This help.",
 		"-v",		"Print version.",
 		"-d",		"Decrypt the file.", "Warning, this algorithm works ONLY on alphabetic lowercase characters.", "Remap ciphertext with charemap before using this option.",
@@ -39,10 +50,41 @@ usage() {
 		"-b",		"Show bigrams.",
 		"-t",		"Show trigrams.",
 		"-w",		"Show words.",
-		"-m <file>",	"Use a sample file to generate digram statistics (default samples/moby.txt).",
-		"-i <file>",	"Input file to parse.",
-		"-o <file>",	"Output file with remapped characters.",
-		"-l <file>",	"Remap using the typical character frequency of selected language (default: languages/en.txt).");
+		"-m <file>",	"Use a sample file to generate digram statistics (default samples/moby.txt).", "A directory or a comma separated list, each entry with an optional positive :weight, is counted with -j threads.",
+		"-i <file>",	"Input file to parse, -i and -m may be gzip or zstd compressed.",
+		"-o <file>",	"Output file with remapped characters, written in parallel with -j threads.",
+		"-l <file>",	"Remap using the typical character frequency of selected language (default: languages/en.txt).",
+		"-j <threads>",	"Score the swaps of each decryption sweep in parallel (default 1, 0 means one per CPU).",
+		"-P <policy>",	"Swap acceptance policy while decrypting, `first' or `best' improvement (default first).",
+		"-W",		"Solve word patterns against the sample words, alone or to seed -d.",
+		"-n <n>",	"Show only the n most frequent bigrams, trigrams or words.",
+		"-f <format>",	"Format of the bigram, trigram and word reports: `text', `tsv' or `json' (default text).");
+	printf("Long options:\n  %-24s %s\n                             %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n                             %s\n  %-24s %s\n  %-24s %s\n                             %s\n  %-24s %s\n                             %s\n  %-24s %s\n                             %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n  %-24s %s\n                             %s\n  %-24s %s\n  %-24s %s\n                             %s\n  %-24s %s\n                             %s\n",
+		"--detect-language",	"Rank every profile in languages/ and model in samples/ against the input.", "Unless given, -l and -m are set to the best match.",
+		"--vigenere",		"Decrypt a periodic cipher made of shifted alphabets (Vigenere).",
+		"--periodic",		"Decrypt a periodic cipher made of substitution alphabets.",
+		"--period <n>",		"Use this period instead of estimating it.",
+		"--bench-vigenere",	"Encrypt every file in samples/ but the -m ones with synthetic keys and time the solver.",
+		"--time-limit <seconds>",	"Stop decrypting after this time and print the best key so far.",
+		"--max-evals <n>",	"Stop decrypting after scoring this many keys and print the best key so far.",
+		"SIGINT and SIGTERM also stop the search and print the best key so far.",
+		"--dump-counts <file>",	"Write the character, bigram, trigram and word counts of the input to a binary file.",
+		"--merge-counts <file>",	"Sum the count files given as arguments into one, usable with -m and -l.",
+		"Files are read in parallel with -j threads.",
+		"--window <n>",		"Compare the letters of two adjacent sliding windows of n letters each (500 is fine)",
+		"and print the divergence and the split points where the key seems to change.",
+		"--bench-decrypt",	"Encrypt excerpts of samples/ with random keys and report the accuracy and time of -d",
+		"for every search configuration. The -m files are the model and are not excerpted.",
+		"--bench-lengths <list>",	"Comma separated excerpt lengths in characters (default "BENCH_LENGTHS").",
+		"--bench-trials <n>",	"Excerpts per length (default 10).",
+		"--fix <c=p,...>",	"Cipher letter c is known to decrypt to p, the search leaves it alone.",
+		"--crib <text>",	"Slide a known piece of plaintext over the input and list where it fits.",
+		"Letters every placement agrees on are fixed as with --fix, all of them if it fits in one place.",
+		"--crib-at <offset>",	"Fix the letters of the crib placed at this byte offset.",
+		"--segment",		"Score -d keys by splitting the text into sample words, for text without blanks.",
+		"This is the default when blanks are missing or cut the text in groups of one length.",
+		"--progressive <bytes>",	"Solve -d on slices of the input adding up to about this size, growing them",
+		"until most words decrypt to sample words, then verify the key on the whole input.");
 	exit(EXIT_FAILURE);
 }
 
@@ -75,7 +117,17 @@ sort_by_occ() {
 int
 load_lang(FILE *l, char *map) {
 	int c, i = 0;
+	Counts *cnt;
 
+	/* a count file gives its letters by decreasing frequency */
+	if(is_counts(l)) {
+		cnt = counts_new();
+		if(counts_read(cnt, l) < 0)
+			die("The language file is not a valid count file.");
+		i = counts_lang(cnt, map);
+		counts_free(cnt);
+		return i;
+	}
 	while((c = fgetc(l)) != EOF)
 		map[i++] = c;
 
@@ -91,6 +143,8 @@ initialize_relation(FILE *fi) {
 		r[i].occ = 0;
 		r[i].new = '?';
 	}
+	/* --crib and --detect-language may have read the input already */
+	rewind(fi);
 	c = fgetc(fi);
 	/* by default everything to lowercase */
 	if(!case_sensitive)
@@ -161,14 +215,13 @@ print_char_occ() {
 		}
 }
 
+/* substitute() of every byte, looked up once */
 void
-remap_file_to_file(FILE *fi, FILE *fo) {
+substitution_table(char *table) {
 	int c;
 
-	rewind(fi);
-	while((c = fgetc(fi)) != EOF) {
-		putc(substitute(c), fo);
-	}
+	for(c=0; c<N; c++)
+		table[c] = substitute(c);
 }
 
 void
@@ -190,15 +243,49 @@ main(int argc, char *argv[]) {
 	char out[N] = {'\0'};
 	char lang[N] = {'\0'};
 	char sample[N] = {'\0'};
+	char dump[N] = {'\0'};
+	char merge[N] = {'\0'};
 	GList *word_list = NULL;
 	GList *bigram_list = NULL;
 	GList *trigram_list = NULL;
+	Search search = {1, FIRST_IMPROVEMENT, 0, 0, 0, {0}, 0, 0};
+	int top = 0, format = FORMAT_TEXT;
+	int detect_flag = 0;
+	int periodic_flag = 0, period = 0, bench_flag = 0;
+	int window = 0;
+	int accuracy_flag = 0, trials = BENCH_TRIALS;
+	char lengths[N] = BENCH_LENGTHS;
+	char crib[N] = {'\0'};
+	char known[KEYSIZE];
+	char table[N];
+	long crib_at = -1, crib_used, placements;
+	struct option long_options[] = {
+		{"detect-language",	no_argument,	NULL,	OPT_DETECT_LANGUAGE},
+		{"vigenere",		no_argument,	NULL,	OPT_VIGENERE},
+		{"periodic",		no_argument,	NULL,	OPT_PERIODIC},
+		{"period",		required_argument,	NULL,	OPT_PERIOD},
+		{"bench-vigenere",	no_argument,	NULL,	OPT_BENCH_VIGENERE},
+		{"time-limit",		required_argument,	NULL,	OPT_TIME_LIMIT},
+		{"max-evals",		required_argument,	NULL,	OPT_MAX_EVALS},
+		{"dump-counts",		required_argument,	NULL,	OPT_DUMP_COUNTS},
+		{"merge-counts",	required_argument,	NULL,	OPT_MERGE_COUNTS},
+		{"window",		required_argument,	NULL,	OPT_WINDOW},
+		{"bench-decrypt",	no_argument,	NULL,	OPT_BENCH_DECRYPT},
+		{"bench-lengths",	required_argument,	NULL,	OPT_BENCH_LENGTHS},
+		{"bench-trials",	required_argument,	NULL,	OPT_BENCH_TRIALS},
+		{"fix",			required_argument,	NULL,	OPT_FIX},
+		{"crib",		required_argument,	NULL,	OPT_CRIB},
+		{"crib-at",		required_argument,	NULL,	OPT_CRIB_AT},
+		{"segment",		no_argument,	NULL,	OPT_SEGMENT},
+		{"progressive",		required_argument,	NULL,	OPT_PROGRESSIVE},
+		{NULL,			0,		NULL,	0}
+	};
         extern char *optarg;
 	extern int optind, opterr, optopt;
 
 	/* handle command line options */
 	opterr = 0;
-	while((c = getopt(argc, argv, "vscdabptwhm:i:o:l:")) != -1)
+	while((c = getopt_long(argc, argv, "vscdabptwWhm:i:o:l:j:P:n:f:", long_options, NULL)) != -1)
 		switch(c) {
 			case 'v':
 				die("charemap-"VERSION", © 2009-2010 Marco Squarcina, see LICENSE for details");
@@ -227,10 +314,97 @@ main(int argc, char *argv[]) {
 			case 'p':
 				print_substituted = 1;
 				break;
+			case 'W':
+				search.patterns = 1;
+				break;
+			case 'n':
+				top = atoi(optarg);
+				break;
+			case 'f':
+				if(strcmp(optarg, "text") == 0)
+					format = FORMAT_TEXT;
+				else if(strcmp(optarg, "tsv") == 0)
+					format = FORMAT_TSV;
+				else if(strcmp(optarg, "json") == 0)
+					format = FORMAT_JSON;
+				else
+					die("Unknown format, use `text', `tsv' or `json'.");
+				break;
+			case OPT_DETECT_LANGUAGE:
+				detect_flag = 1;
+				break;
+			case OPT_VIGENERE:
+				periodic_flag = SHIFT_ALPHABETS;
+				break;
+			case OPT_PERIODIC:
+				periodic_flag = SUBSTITUTION_ALPHABETS;
+				break;
+			case OPT_PERIOD:
+				period = atoi(optarg);
+				if(period < 1 || period > MAXPERIOD)
+					die("The period must be between 1 and 32.");
+				break;
+			case OPT_BENCH_VIGENERE:
+				bench_flag = 1;
+				break;
+			case OPT_TIME_LIMIT:
+				search.time_limit = atof(optarg);
+				if(search.time_limit <= 0)
+					die("The time limit must be a positive number of seconds.");
+				break;
+			case OPT_MAX_EVALS:
+				search.max_evals = atol(optarg);
+				if(search.max_evals <= 0)
+					die("The evaluation limit must be a positive number.");
+				break;
+			case OPT_DUMP_COUNTS:
+				strcpy(dump, optarg);
+				break;
+			case OPT_MERGE_COUNTS:
+				strcpy(merge, optarg);
+				break;
+			case OPT_WINDOW:
+				window = atoi(optarg);
+				if(window < WINDOW_MIN)
+					die("The window must be at least 16 letters.");
+				break;
+			case OPT_BENCH_DECRYPT:
+				accuracy_flag = 1;
+				break;
+			case OPT_BENCH_LENGTHS:
+				strcpy(lengths, optarg);
+				break;
+			case OPT_BENCH_TRIALS:
+				trials = atoi(optarg);
+				if(trials < 1)
+					die("The number of trials must be positive.");
+				break;
+			case OPT_FIX:
+				if(parse_fix(optarg, search.fixed) < 0)
+					die("Use --fix c=p[,c=p...] with lowercase letters, each plain letter for one cipher letter.");
+				break;
+			case OPT_CRIB:
+				strcpy(crib, optarg);
+				break;
+			case OPT_SEGMENT:
+				search.segment = 1;
+				break;
+			case OPT_PROGRESSIVE:
+				search.progressive = atol(optarg);
+				if(search.progressive <= 0)
+					die("The progressive sample size must be a positive number of bytes.");
+				break;
+			case OPT_CRIB_AT:
+				crib_at = atol(optarg);
+				if(crib_at < 0)
+					die("The crib offset must not be negative.");
+				break;
 			case 'h':
 				usage();
 				break;
 			case 'm':
+				if(strlen(optarg) >= N)
+					die("The sample list is too long, name a directory instead.");
 				strcpy(sample, optarg);
 				break;
 			case 'i':
@@ -242,8 +416,21 @@ main(int argc, char *argv[]) {
 			case 'l':
 				strcpy(lang, optarg);
 				break;
+			case 'j':
+				search.threads = atoi(optarg);
+				if(search.threads <= 0)
+					search.threads = g_get_num_processors();
+				break;
+			case 'P':
+				if(strcmp(optarg, "first") == 0)
+					search.policy = FIRST_IMPROVEMENT;
+				else if(strcmp(optarg, "best") == 0)
+					search.policy = BEST_IMPROVEMENT;
+				else
+					die("Unknown policy, use `first' or `best'.");
+				break;
 			case '?':
-				if(optopt == 'i' || optopt == 'o' || optopt == 'l' || optopt == 'm')
+				if(optopt == 'i' || optopt == 'o' || optopt == 'l' || optopt == 'm' || optopt == 'j' || optopt == 'P' || optopt == 'n' || optopt == 'f')
 					fprintf(stderr, "Option -%c requires an argument.\n", optopt);
 				else if(isprint(optopt))
 					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -253,10 +440,48 @@ main(int argc, char *argv[]) {
 			default:
 				die("Try `-h' for more information.");
 		}
+	/* merging reduces the count files given as arguments, nothing else */
+	if(strlen(merge) > 0) {
+		if(optind >= argc)
+			die("You need at least a count file to merge!\nTry `-h' for more information.");
+		if(merge_counts(argv + optind, argc - optind, merge, search.threads) < 0)
+			die("Merging the count files failed.");
+		return 0;
+	}
 	for(i = optind; i < argc; i++) {
 		printf("Non-option argument %s\n", argv[i]);
 		die("Try `-h' for more information.");
 	}
+	if(search.progressive > 0 && !decrypt_flag)
+		die("--progressive only applies to -d.\nTry `-h' for more information.");
+	/* benchmarks bring their own input */
+	if(bench_flag) {
+		if(strlen(sample) == 0)
+			strcpy(sample, "samples/moby.txt");
+		if((fs = open_sample(sample, search.threads)) == NULL)
+			die("Sample file not found.");
+		bench_periodic(fs, sample, &search);
+		fclose(fs);
+		return 0;
+	}
+	if(accuracy_flag) {
+		if(strlen(sample) == 0)
+			strcpy(sample, "samples/moby.txt");
+		if((fs = open_sample(sample, search.threads)) == NULL)
+			die("Sample file not found.");
+		if(bench_decrypt(fs, sample, &search, lengths, trials) < 0)
+			die("The lengths must be a comma separated list of positive numbers.");
+		fclose(fs);
+		return 0;
+	}
+	/* check for an input file */
+	if(strlen(in) == 0)
+		die("You need at least an input file!\nTry `-h' for more information.");
+        if((fi = open_input(in)) == NULL)
+		die("Input file not found.");
+	/* pick language and sample, unless given, from the closest profiles */
+	if(detect_flag)
+		detect_language(fi, search.threads, strlen(lang) == 0 ? lang : NULL, strlen(sample) == 0 ? sample : NULL);
 	/* set default language */
 	if(strlen(lang) == 0)
 		strcpy(lang, "languages/en.txt");
@@ -268,44 +493,67 @@ main(int argc, char *argv[]) {
 	/* check for the sample file */
 	if(strlen(sample) == 0)
 		strcpy(sample, "samples/moby.txt");
-        if((fs = fopen(sample, "r")) == NULL)
+        if((fs = open_sample(sample, search.threads)) == NULL)
 		die("Sample file not found.");
-	/* check for an input file */
-	if(strlen(in) == 0)
-		die("You need at least an input file!\nTry `-h' for more information.");
-        if((fi = fopen(in, "r")) == NULL)
-		die("Input file not found.");
+	/* known plaintext narrows the key down before any search */
+	if(strlen(crib) > 0) {
+		crib_used = crib_at;
+		placements = place_crib(fi, crib, search.fixed, &crib_used, known);
+		if(crib_at >= 0 && crib_used < 0)
+			die("The crib does not fit at that offset.");
+		if(placements == 0)
+			die("The crib does not fit the ciphertext.");
+		/* several placements only fix the letters they all agree on */
+		if(crib_used < 0)
+			printf("Keeping the letters every placement agrees on, choose one with --crib-at for the others.\n\n");
+		memcpy(search.fixed, known, KEYSIZE);
+	}
 	/* create relation */
 	rl = initialize_relation(fi);
+	/* damaged compressed input must not pass for a shorter text */
+	if(ferror(fi))
+		die("Input file cannot be read to its end.");
 	/* sort array */
 	sort_by_occ();
 	/* associate each character to a new one */
 	associate();
-	if(decrypt_flag)
-		decrypt(fi, fs);
+	if(periodic_flag)
+		periodic_decrypt(fi, fs, &search, periodic_flag == SHIFT_ALPHABETS, period);
+	else if(decrypt_flag && search.progressive > 0)
+		progressive_decrypt(fi, fs, &search);
+	else if(decrypt_flag)
+		decrypt(fi, fs, &search);
+	else if(search.patterns)
+		pattern_decrypt(fi, fs, search.fixed);
+	/* look for key changes before trusting global statistics */
+	if(window > 0)
+		window_analysis(fi, window);
+	/* save the counts of the input for --merge-counts, -m and -l */
+	if(strlen(dump) > 0 && dump_counts(fi, dump) < 0)
+		die("Cannot write the count file.");
 	/* show char set */
 	if(show_occ)
 		print_char_occ();
 	if(show_bigrams) {
 		bigram_list = count_bigrams(fi, bigram_list, case_sensitive, alpha_only);
-		print_bigrams(bigram_list);
+		print_bigrams(bigram_list, top, format);
 		free_list(bigram_list);
 	}
 	if(show_trigrams) {
 		trigram_list = count_trigrams(fi, trigram_list, case_sensitive, alpha_only);
-		print_trigrams(trigram_list);
+		print_trigrams(trigram_list, top, format);
 		free_list(trigram_list);
 	}
 	if(show_words) {
 		word_list = count_words(fi, word_list, case_sensitive);
-		print_words(word_list);
+		print_words(word_list, top, format);
 		free_list(word_list);
 	}
 	/* print translated text file to stdout or a file */
 	if(strlen(out) > 0) {
-		ftmp = fopen(out, "w");
-		remap_file_to_file(fi, ftmp);
-		fclose(ftmp);
+		substitution_table(table);
+		if(remap_file(fi, out, table, search.threads) < 0)
+			die("Cannot write the output file.");
 	}
 	if(print_substituted)
 		remap_to_video(fi);
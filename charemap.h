@@ -4,6 +4,26 @@
 
 #define N	256
 
+/* long only options */
+#define OPT_DETECT_LANGUAGE	256
+#define OPT_VIGENERE		257
+#define OPT_PERIODIC		258
+#define OPT_PERIOD		259
+#define OPT_BENCH_VIGENERE	260
+#define OPT_TIME_LIMIT		261
+#define OPT_MAX_EVALS		262
+#define OPT_DUMP_COUNTS		263
+#define OPT_MERGE_COUNTS	264
+#define OPT_WINDOW		265
+#define OPT_BENCH_DECRYPT	266
+#define OPT_BENCH_LENGTHS	267
+#define OPT_BENCH_TRIALS	268
+#define OPT_FIX			269
+#define OPT_CRIB		270
+#define OPT_CRIB_AT		271
+#define OPT_SEGMENT		272
+#define OPT_PROGRESSIVE		273
+
 /* structs */
 typedef struct {
 	unsigned char orig;
@@ -20,7 +40,7 @@ int load_lang(FILE *l, char *map);
 int initialize_relation(FILE *fi);
 void associate(void);
 void print_char_occ(void);
-void remap_file_to_file(FILE *fi, FILE *fo);
+void substitution_table(char *table);
 void remap_to_video(FILE *fi);
 
 /* variables */
@@ -9,6 +9,14 @@ CFLAGS   = -std=c99 -pedantic -Wall -Wextra -march=native -DVERSION=\"${VERSION}
 CFLAGS  += -mfpmath=sse # x86 only, remove it if you are on a different arch.
 CPPFLAGS = $(shell pkg-config glib-2.0 --cflags)
 LDLIBS   = $(shell pkg-config glib-2.0 --libs)
+# after the objects, linkers that drop unused libraries would skip it
+LDLIBS   += -lm
+
+# compressed input (-i, -m), comment out to build without zlib or zstd
+CPPFLAGS += -DHAVE_ZLIB $(shell pkg-config zlib --cflags)
+LDLIBS   += $(shell pkg-config zlib --libs)
+CPPFLAGS += -DHAVE_ZSTD $(shell pkg-config libzstd --cflags)
+LDLIBS   += $(shell pkg-config libzstd --libs)
 
 # compiler and linker
 CC       = gcc
@@ -0,0 +1,681 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: counts.c, character, bigram, trigram and word counts saved in
+ * 		a compact binary file. Count files of different shards of a
+ * 		corpus are summed into one, which -m and -l accept like text.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "source.h"
+#include "counts.h"
+
+/* function implementations */
+Counts *
+counts_new(void) {
+	Counts *c;
+
+	c = calloc(1, sizeof(Counts));
+	c->words = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free);
+
+	return c;
+}
+
+void
+counts_free(Counts *c) {
+	g_hash_table_destroy(c->words);
+	free(c);
+}
+
+static void
+add_word(Counts *c, const char *w, guint64 occ) {
+	guint64 *v;
+
+	if((v = g_hash_table_lookup(c->words, w)) == NULL) {
+		v = malloc(sizeof(guint64));
+		*v = 0;
+		g_hash_table_insert(c->words, g_strdup(w), v);
+	}
+	*v += occ;
+}
+
+int
+counts_scan(Counts *c, FILE *f) {
+	int ch, c0 = EOF, c1 = EOF, i = 0;
+	char buf[N];
+
+	/* one pass, counting the same way as the text based functions */
+	rewind(f);
+	while((ch = fgetc(f)) != EOF) {
+		c->chars[ch]++;
+		if(!isalpha(ch)) {
+			if(i) {
+				buf[i] = '\0';
+				add_word(c, buf, 1);
+				i = 0;
+			}
+			c0 = c1 = EOF;
+			continue;
+		}
+		ch = tolower(ch);
+		if(c1 != EOF) {
+			c->b[c1-OFFSET][ch-OFFSET]++;
+			c->nb++;
+			if(c0 != EOF) {
+				c->t[c0-OFFSET][c1-OFFSET][ch-OFFSET]++;
+				c->nt++;
+			}
+		}
+		c0 = c1;
+		c1 = ch;
+		/* overlong words are cut like count_words() does */
+		if(i > N-2) {
+			buf[i] = '\0';
+			add_word(c, buf, 1);
+			i = 0;
+			continue;
+		}
+		buf[i++] = ch;
+	}
+	if(i) {
+		buf[i] = '\0';
+		add_word(c, buf, 1);
+	}
+
+	return ferror(f) ? -1 : 0;
+}
+
+void
+counts_add(Counts *c, Counts *d) {
+	GHashTableIter it;
+	gpointer k, v;
+	int i, j, l;
+
+	for(i=0; i<N; i++)
+		c->chars[i] += d->chars[i];
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			c->b[i][j] += d->b[i][j];
+			for(l=0; l<KEYSIZE; l++)
+				c->t[i][j][l] += d->t[i][j][l];
+		}
+	c->nb += d->nb;
+	c->nt += d->nt;
+	g_hash_table_iter_init(&it, d->words);
+	while(g_hash_table_iter_next(&it, &k, &v))
+		add_word(c, k, *(guint64 *)v);
+}
+
+/* counts are stored as LEB128 varints, most of the trigrams take a byte */
+static void
+put_varint(FILE *f, guint64 v) {
+	while(v >= 0x80) {
+		putc((int)(v & 0x7f) | 0x80, f);
+		v >>= 7;
+	}
+	putc((int)v, f);
+}
+
+static int
+get_varint(FILE *f, guint64 *v) {
+	int ch, shift = 0;
+
+	*v = 0;
+	while((ch = getc(f)) != EOF) {
+		if(shift > 63)
+			return -1;
+		*v |= (guint64)(ch & 0x7f) << shift;
+		if(!(ch & 0x80))
+			return 0;
+		shift += 7;
+	}
+
+	return -1;
+}
+
+static int
+by_word(const void *x, const void *y) {
+	return strcmp(*(char * const *)x, *(char * const *)y);
+}
+
+int
+counts_write(Counts *c, FILE *f) {
+	GHashTableIter it;
+	gpointer k, v;
+	char **words;
+	int i, j, l, n = 0;
+
+	fwrite(COUNTS_MAGIC, 1, strlen(COUNTS_MAGIC), f);
+	put_varint(f, COUNTS_VERSION);
+	for(i=0; i<N; i++)
+		put_varint(f, c->chars[i]);
+	put_varint(f, c->nb);
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++)
+			put_varint(f, c->b[i][j]);
+	put_varint(f, c->nt);
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++)
+			for(l=0; l<KEYSIZE; l++)
+				put_varint(f, c->t[i][j][l]);
+	/* sorted, the same counts always give the same file */
+	words = malloc(g_hash_table_size(c->words) * sizeof(char *) + 1);
+	g_hash_table_iter_init(&it, c->words);
+	while(g_hash_table_iter_next(&it, &k, &v))
+		words[n++] = k;
+	qsort(words, n, sizeof(char *), by_word);
+	put_varint(f, n);
+	for(i=0; i<n; i++) {
+		l = strlen(words[i]);
+		put_varint(f, l);
+		fwrite(words[i], 1, l, f);
+		put_varint(f, *(guint64 *)g_hash_table_lookup(c->words, words[i]));
+	}
+	free(words);
+
+	return ferror(f) ? -1 : 0;
+}
+
+int
+is_counts(FILE *f) {
+	char m[sizeof(COUNTS_MAGIC)];
+	size_t n;
+
+	rewind(f);
+	n = fread(m, 1, strlen(COUNTS_MAGIC), f);
+	rewind(f);
+
+	return n == strlen(COUNTS_MAGIC) && memcmp(m, COUNTS_MAGIC, n) == 0;
+}
+
+int
+counts_read(Counts *c, FILE *f) {
+	guint64 v, n, len, occ;
+	char buf[N];
+	int i, j, l;
+
+	if(!is_counts(f) || fread(buf, 1, strlen(COUNTS_MAGIC), f) != strlen(COUNTS_MAGIC))
+		return -1;
+	if(get_varint(f, &v) < 0 || v != COUNTS_VERSION)
+		return -1;
+	/* the sums go into c, reading many files merges them */
+	for(i=0; i<N; i++) {
+		if(get_varint(f, &v) < 0)
+			return -1;
+		c->chars[i] += v;
+	}
+	if(get_varint(f, &v) < 0)
+		return -1;
+	c->nb += v;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			if(get_varint(f, &v) < 0)
+				return -1;
+			c->b[i][j] += v;
+		}
+	if(get_varint(f, &v) < 0)
+		return -1;
+	c->nt += v;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++)
+			for(l=0; l<KEYSIZE; l++) {
+				if(get_varint(f, &v) < 0)
+					return -1;
+				c->t[i][j][l] += v;
+			}
+	if(get_varint(f, &n) < 0)
+		return -1;
+	for(; n > 0; n--) {
+		if(get_varint(f, &len) < 0 || len > N-1 || fread(buf, 1, len, f) != len)
+			return -1;
+		buf[len] = '\0';
+		if(get_varint(f, &occ) < 0)
+			return -1;
+		add_word(c, buf, occ);
+	}
+
+	return 0;
+}
+
+static void
+letter_order(Counts *c, char *k) {
+	guint64 occ[KEYSIZE];
+	int i, j, tmp = 0, done[KEYSIZE] = {0};
+
+	for(i=0; i<KEYSIZE; i++)
+		occ[i] = c->chars[i+OFFSET] + c->chars[toupper(i+OFFSET)];
+	/* same tie breaking as guess_key() */
+	for(i=0; i<KEYSIZE; i++) {
+		for(j=0, tmp=-1; j<KEYSIZE; j++)
+			if(!done[j] && (tmp < 0 || occ[j] >= occ[tmp]))
+				tmp = j;
+		done[tmp] = 1;
+		k[i] = tmp+OFFSET;
+	}
+}
+
+Model *
+counts_model(Counts *c) {
+	Model *m;
+	guint64 max = 0;
+	int i, j, l, shift = 0;
+
+	m = malloc(sizeof(Model));
+	letter_order(c, m->ks);
+	/* the model keeps 32 bit counts, scale merged corpora down to fit */
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			max = c->b[i][j] > max ? c->b[i][j] : max;
+			for(l=0; l<KEYSIZE; l++)
+				max = c->t[i][j][l] > max ? c->t[i][j][l] : max;
+		}
+	while((max >> shift) > G_MAXUINT32)
+		shift++;
+	m->nb = m->nt = 0;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			m->b[i][j] = c->b[i][j] >> shift;
+			m->nb += m->b[i][j];
+			for(l=0; l<KEYSIZE; l++) {
+				m->t[i][j][l] = c->t[i][j][l] >> shift;
+				m->nt += m->t[i][j][l];
+			}
+		}
+
+	return m;
+}
+
+static gint
+by_occ(gconstpointer x, gconstpointer y) {
+	const Word *a = x, *b = y;
+
+	if(a->occ != b->occ)
+		return a->occ < b->occ ? 1 : -1;
+	return strcmp(a->word, b->word);
+}
+
+GList *
+counts_words(Counts *c) {
+	GHashTableIter it;
+	gpointer k, v;
+	GList *l = NULL;
+	Word *w;
+
+	g_hash_table_iter_init(&it, c->words);
+	while(g_hash_table_iter_next(&it, &k, &v)) {
+		w = malloc(sizeof(Word));
+		strcpy(w->word, k);
+		w->occ = *(guint64 *)v > G_MAXINT ? G_MAXINT : (int)*(guint64 *)v;
+		l = g_list_prepend(l, w);
+	}
+
+	/* most frequent first, as count_words() keeps them */
+	return g_list_sort(l, by_occ);
+}
+
+int
+counts_lang(Counts *c, char *map) {
+	letter_order(c, map);
+
+	return KEYSIZE;
+}
+
+GList *
+sample_words(FILE *fs) {
+	Counts *c;
+	GList *l;
+
+	if(!is_counts(fs)) {
+		l = count_words(fs, NULL, 0);
+		if(ferror(fs))
+			die("The sample file cannot be read to its end.");
+		return l;
+	}
+	c = counts_new();
+	if(counts_read(c, fs) < 0)
+		die("The sample file is not a valid count file.");
+	l = counts_words(c);
+	counts_free(c);
+
+	return l;
+}
+
+int
+dump_counts(FILE *fi, const char *path) {
+	Counts *c;
+	FILE *fo;
+	int ret;
+
+	if((fo = fopen(path, "wb")) == NULL)
+		return -1;
+	c = counts_new();
+	ret = counts_scan(c, fi);
+	if(counts_write(c, fo) < 0)
+		ret = -1;
+	if(fclose(fo) != 0)
+		ret = -1;
+	counts_free(c);
+
+	return ret;
+}
+
+void
+counts_scale(Counts *c, double w) {
+	GHashTableIter it;
+	gpointer k, v;
+	int i, j, l;
+
+	for(i=0; i<N; i++)
+		c->chars[i] = c->chars[i] * w + 0.5;
+	c->nb = c->nt = 0;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			c->b[i][j] = c->b[i][j] * w + 0.5;
+			c->nb += c->b[i][j];
+			for(l=0; l<KEYSIZE; l++) {
+				c->t[i][j][l] = c->t[i][j][l] * w + 0.5;
+				c->nt += c->t[i][j][l];
+			}
+		}
+	g_hash_table_iter_init(&it, c->words);
+	while(g_hash_table_iter_next(&it, &k, &v))
+		*(guint64 *)v = *(guint64 *)v * w + 0.5;
+}
+
+static gpointer
+merge_shard(gpointer data) {
+	Shard *s = data;
+	Counts *c;
+	FILE *f;
+	int i;
+
+	/* threads take the next file until none is left, big files first */
+	while((i = g_atomic_int_add(s->next, 1)) < s->nfiles) {
+		if((f = open_input(s->files[i])) == NULL) {
+			fprintf(stderr, "%s: file not found.\n", s->files[i]);
+			s->failed = 1;
+			continue;
+		}
+		c = s->weights == NULL || s->weights[i] == 1 ? s->c : counts_new();
+		if(s->text && !is_counts(f)) {
+			if(counts_scan(c, f) < 0) {
+				fprintf(stderr, "%s: cannot be read to its end.\n", s->files[i]);
+				s->failed = 1;
+			}
+		}
+		else if(counts_read(c, f) < 0) {
+			fprintf(stderr, "%s: not a valid count file.\n", s->files[i]);
+			s->failed = 1;
+		}
+		fclose(f);
+		if(c != s->c) {
+			counts_scale(c, s->weights[i]);
+			counts_add(s->c, c);
+			counts_free(c);
+		}
+	}
+
+	return NULL;
+}
+
+/* sum of the files, text or counts, in one Counts with nthreads threads */
+static Counts *
+count_files(char **files, double *weights, int nfiles, int text, int nthreads) {
+	GThread **threads;
+	Counts *c;
+	Shard *s;
+	gint next = 0;
+	int i, n, failed = 0;
+
+	n = nthreads < 1 ? 1 : nthreads;
+	n = n > nfiles ? nfiles : n;
+	if(n < 1)
+		return NULL;
+	s = malloc(n * sizeof(Shard));
+	threads = malloc(n * sizeof(GThread *));
+	for(i=0; i<n; i++) {
+		s[i].c = counts_new();
+		s[i].files = files;
+		s[i].weights = weights;
+		s[i].nfiles = nfiles;
+		s[i].next = &next;
+		s[i].text = text;
+		s[i].failed = 0;
+		if(i > 0)
+			threads[i] = g_thread_new("merge", merge_shard, &s[i]);
+	}
+	merge_shard(&s[0]);
+	for(i=1; i<n; i++) {
+		g_thread_join(threads[i]);
+		counts_add(s[0].c, s[i].c);
+		counts_free(s[i].c);
+	}
+	for(i=0; i<n; i++)
+		failed |= s[i].failed;
+	c = s[0].c;
+	if(failed) {
+		counts_free(c);
+		c = NULL;
+	}
+	free(threads);
+	free(s);
+
+	return c;
+}
+
+int
+merge_counts(char **files, int nfiles, const char *path, int nthreads) {
+	Counts *c;
+	FILE *fo;
+	int ret;
+
+	if((c = count_files(files, NULL, nfiles, 0, nthreads)) == NULL)
+		return -1;
+	if((fo = fopen(path, "wb")) == NULL)
+		ret = -1;
+	else {
+		ret = counts_write(c, fo);
+		if(fclose(fo) != 0)
+			ret = -1;
+	}
+	counts_free(c);
+
+	return ret;
+}
+
+typedef struct {
+	char *path;
+	double weight;
+	long size;
+} Corpus;
+
+static gint
+by_size(gconstpointer x, gconstpointer y) {
+	const Corpus *a = x, *b = y;
+
+	if(a->size != b->size)
+		return a->size < b->size ? 1 : -1;
+	return strcmp(a->path, b->path);
+}
+
+static GList *
+add_corpus(GList *l, const char *path, double weight) {
+	Corpus *c;
+	FILE *f;
+
+	c = malloc(sizeof(Corpus));
+	c->path = g_strdup(path);
+	c->weight = weight;
+	c->size = 0;
+	if((f = fopen(path, "r")) != NULL) {
+		fseek(f, 0, SEEK_END);
+		c->size = ftell(f);
+		fclose(f);
+	}
+
+	return g_list_prepend(l, c);
+}
+
+/* files of a directory, not recursing, with the weight of the directory */
+static GList *
+add_dir(GList *l, const char *dir, double weight) {
+	const gchar *name;
+	gchar *path;
+	GDir *d;
+
+	if((d = g_dir_open(dir, 0, NULL)) == NULL)
+		return l;
+	while((name = g_dir_read_name(d)) != NULL) {
+		path = g_build_filename(dir, name, NULL);
+		if(g_file_test(path, G_FILE_TEST_IS_REGULAR))
+			l = add_corpus(l, path, weight);
+		g_free(path);
+	}
+	g_dir_close(d);
+
+	return l;
+}
+
+static void
+free_corpus(gpointer data) {
+	Corpus *c = data;
+
+	g_free(c->path);
+	free(c);
+}
+
+/* a -m spec naming one file, not a list, a directory or a weight */
+static int
+single_sample(const char *spec) {
+	return strchr(spec, CORPUS_SEP) == NULL && !g_file_test(spec, G_FILE_TEST_IS_DIR) &&
+		(g_file_test(spec, G_FILE_TEST_EXISTS) || strrchr(spec, WEIGHT_SEP) == NULL);
+}
+
+/* the files of a list spec, biggest first, set *valid to 0 on a bad weight */
+static GList *
+corpus_list(const char *spec, int *valid) {
+	GList *l = NULL;
+	char **entries, *sep, *end;
+	double w;
+	int i;
+
+	*valid = 1;
+	entries = g_strsplit(spec, (char []){CORPUS_SEP, '\0'}, -1);
+	for(i=0; entries[i] != NULL; i++) {
+		w = 1;
+		/* a trailing :weight, unless the colon is part of the name */
+		if(!g_file_test(entries[i], G_FILE_TEST_EXISTS) && (sep = strrchr(entries[i], WEIGHT_SEP)) != NULL) {
+			w = strtod(sep + 1, &end);
+			if(end == sep + 1 || *end != '\0' || w <= 0) {
+				fprintf(stderr, "%s: not a valid weight.\n", entries[i]);
+				g_list_free_full(l, free_corpus);
+				g_strfreev(entries);
+				*valid = 0;
+				return NULL;
+			}
+			*sep = '\0';
+		}
+		if(g_file_test(entries[i], G_FILE_TEST_IS_DIR))
+			l = add_dir(l, entries[i], w);
+		else if(strlen(entries[i]) > 0)
+			l = add_corpus(l, entries[i], w);
+	}
+	g_strfreev(entries);
+
+	/* the biggest files go first, the last ones to finish are short */
+	return g_list_sort(l, by_size);
+}
+
+/* the paths open_sample() counts for spec, NULL terminated */
+char **
+sample_files(const char *spec) {
+	GList *l, *iter;
+	char **files;
+	int i, valid;
+
+	if(single_sample(spec)) {
+		files = g_new(char *, 2);
+		files[0] = g_strdup(spec);
+		files[1] = NULL;
+		return files;
+	}
+	l = corpus_list(spec, &valid);
+	files = g_new(char *, g_list_length(l) + 1);
+	for(iter = l, i = 0; iter != NULL; iter = iter->next, i++)
+		files[i] = g_strdup(((Corpus *)iter->data)->path);
+	files[i] = NULL;
+	g_list_free_full(l, free_corpus);
+
+	return files;
+}
+
+/* whether path is one of the files of sample_files(), the same file by any path */
+int
+in_model(char **model, const char *path) {
+	char *a, *b;
+	int i, found = 0;
+
+	if((a = realpath(path, NULL)) == NULL)
+		return 0;
+	for(i=0; model[i] != NULL && !found; i++) {
+		if((b = realpath(model[i], NULL)) == NULL)
+			continue;
+		found = strcmp(a, b) == 0;
+		free(b);
+	}
+	free(a);
+
+	return found;
+}
+
+/*
+ * the sample for -m: a file as it is, or the weighted sum of the counts of
+ * a list of files and directories, counted in parallel into a count file
+ */
+FILE *
+open_sample(const char *spec, int nthreads) {
+	Counts *c;
+	Corpus *cp;
+	GList *l, *iter;
+	FILE *fo = NULL;
+	char **files;
+	double *weights;
+	int i, n, valid;
+
+	if(single_sample(spec))
+		return open_input(spec);
+	if((l = corpus_list(spec, &valid)) == NULL && !valid)
+		return NULL;
+	n = g_list_length(l);
+	files = g_new(char *, n);
+	weights = g_new(double, n);
+	for(iter = l, i = 0; iter != NULL; iter = iter->next, i++) {
+		cp = iter->data;
+		files[i] = cp->path;
+		weights[i] = cp->weight;
+	}
+	if((c = count_files(files, weights, n, 1, nthreads)) != NULL) {
+		/* consumers of -m read count files like text */
+		if((fo = tmpfile()) != NULL && counts_write(c, fo) < 0) {
+			fclose(fo);
+			fo = NULL;
+		}
+		counts_free(c);
+	}
+	if(fo != NULL)
+		rewind(fo);
+	g_free(files);
+	g_free(weights);
+	g_list_free_full(l, free_corpus);
+
+	return fo;
+}
@@ -0,0 +1,51 @@
+/*
+ * Description: counts.h, header file for counts.c
+ */
+
+#include <glib.h>
+
+/* binary count files start with a magic string and a format version */
+#define COUNTS_MAGIC	"CHRMCNTS"
+#define COUNTS_VERSION	1
+/* separators of the -m corpus list and of the weight of an entry */
+#define CORPUS_SEP	','
+#define WEIGHT_SEP	':'
+
+/* structs */
+typedef struct {
+	guint64 chars[N];
+	guint64 nb;
+	guint64 b[KEYSIZE][KEYSIZE];
+	guint64 nt;
+	guint64 t[KEYSIZE][KEYSIZE][KEYSIZE];
+	/* word -> guint64 occurrences */
+	GHashTable *words;
+} Counts;
+
+typedef struct {
+	Counts *c;
+	char **files;
+	double *weights;
+	int nfiles;
+	gint *next;
+	int text;
+	int failed;
+} Shard;
+
+/* function declarations */
+Counts *counts_new(void);
+void counts_free(Counts *c);
+int counts_scan(Counts *c, FILE *f);
+void counts_add(Counts *c, Counts *d);
+int counts_write(Counts *c, FILE *f);
+int counts_read(Counts *c, FILE *f);
+int is_counts(FILE *f);
+Model *counts_model(Counts *c);
+GList *counts_words(Counts *c);
+int counts_lang(Counts *c, char *map);
+GList *sample_words(FILE *fs);
+int dump_counts(FILE *fi, const char *path);
+int merge_counts(char **files, int nfiles, const char *path, int nthreads);
+char **sample_files(const char *spec);
+int in_model(char **model, const char *path);
+FILE *open_sample(const char *spec, int nthreads);
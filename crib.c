@@ -0,0 +1,142 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: crib.c, known plaintext. Letters fixed with --fix, or found
+ * 		by sliding a crib over the ciphertext, are locked in the
+ * 		key and left out of the search.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "crib.h"
+
+/* function implementations */
+
+/* add cipher -> plain pairs, a=x[,b=y...], to fixed; -1 on errors */
+int
+parse_fix(const char *s, char *fixed) {
+	int i, c, p;
+
+	while(*s) {
+		if(!islower((unsigned char)s[0]) || s[1] != '=' || !islower((unsigned char)s[2]))
+			return -1;
+		c = s[0]-OFFSET;
+		p = s[2];
+		if(fixed[c] != 0 && fixed[c] != p)
+			return -1;
+		/* a key is a permutation, two letters can not share a plain one */
+		for(i=0; i<KEYSIZE; i++)
+			if(i != c && fixed[i] == p)
+				return -1;
+		fixed[c] = p;
+		s += 3;
+		if(*s == ',')
+			s++;
+		else if(*s != '\0')
+			return -1;
+	}
+
+	return 0;
+}
+
+/* does crib fit the text at offset at? map gets fixed plus the crib letters */
+int
+crib_fits(const char *text, long len, long at, const char *crib, const char *fixed, char *map) {
+	char inv[KEYSIZE] = {0};
+	int i, c, p;
+
+	memcpy(map, fixed, KEYSIZE);
+	for(i=0; i<KEYSIZE; i++)
+		if(map[i] != 0)
+			inv[map[i]-OFFSET] = i+OFFSET;
+	for(i=0; crib[i] != '\0'; i++) {
+		if(at+i >= len)
+			return 0;
+		c = tolower((unsigned char)text[at+i]);
+		p = tolower((unsigned char)crib[i]);
+		/* blanks and punctuation are not encrypted, they must match */
+		if(!islower(p) || !islower(c)) {
+			if(c != p)
+				return 0;
+			continue;
+		}
+		if(map[c-OFFSET] == 0 && inv[p-OFFSET] == 0) {
+			map[c-OFFSET] = p;
+			inv[p-OFFSET] = c;
+		}
+		else if(map[c-OFFSET] != p)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * slide the crib over the ciphertext and print the placements consistent
+ * with fixed. map gets the letters of the placement at *at or, when *at
+ * is negative, those every placement agrees on, all of the only one if
+ * there is just one; *at is left at the placement used or -1. Returns the
+ * number of placements.
+ */
+long
+place_crib(FILE *fi, const char *crib, const char *fixed, long *at, char *map) {
+	char m[KEYSIZE], agreed[KEYSIZE];
+	char *text;
+	long len = 0, base = 0, keep, i, l, n = 0, used = -1, only = -1;
+	size_t r;
+	int j, k;
+
+	/* blocks overlapping by the crib, compressed inputs are streams */
+	l = strlen(crib);
+	text = malloc(CRIB_BLOCK + l);
+	memcpy(map, fixed, KEYSIZE);
+	printf("Placing crib \"%s\":\n\n", crib);
+	rewind(fi);
+	while((r = fread(text + len, 1, CRIB_BLOCK, fi)) > 0) {
+		len += r;
+		for(i=0; i+l <= len; i++) {
+			if(!crib_fits(text, len, i, crib, fixed, m))
+				continue;
+			if(n < CRIB_SHOW) {
+				printf("\t%8ld: ", base+i);
+				for(j=0, k=0; j<KEYSIZE; j++)
+					if(m[j] != 0 && fixed[j] == 0)
+						printf("%s%c=%c", k++ ? "," : "", j+OFFSET, m[j]);
+				putchar('\n');
+			}
+			if(n == 0) {
+				memcpy(agreed, m, KEYSIZE);
+				only = base+i;
+			}
+			for(j=0; j<KEYSIZE; j++)
+				if(agreed[j] != m[j])
+					agreed[j] = 0;
+			if(base+i == *at) {
+				memcpy(map, m, KEYSIZE);
+				used = base+i;
+			}
+			n++;
+		}
+		/* placements starting in the last l-1 bytes need the next block */
+		keep = len < l ? len : l-1;
+		memmove(text, text + len - keep, keep);
+		base += len - keep;
+		len = keep;
+	}
+	if(n > CRIB_SHOW)
+		printf("\t... %ld more\n", n - CRIB_SHOW);
+	printf("\n%ld placements found.\n\n", n);
+	if(*at < 0 && n > 0)
+		memcpy(map, agreed, KEYSIZE);
+	if(*at < 0 && n == 1)
+		used = only;
+	*at = used;
+	free(text);
+
+	return n;
+}
@@ -0,0 +1,13 @@
+/*
+ * Description: crib.h, header file for crib.c
+ */
+
+/* placements printed at most */
+#define CRIB_SHOW	20
+/* bytes of the input read at a time while sliding the crib */
+#define CRIB_BLOCK	(1 << 16)
+
+/* function declarations */
+int parse_fix(const char *s, char *fixed);
+int crib_fits(const char *text, long len, long at, const char *crib, const char *fixed, char *map);
+long place_crib(FILE *fi, const char *crib, const char *fixed, long *at, char *map);
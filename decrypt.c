@@ -14,6 +14,11 @@
 #include <stdlib.h>
 #include "decrypt.h"
 #include "utils.h"
+#include "sweep.h"
+#include "cache.h"
+#include "pattern.h"
+#include "counts.h"
+#include "segment.h"
 
 /* function implementations */
 void
@@ -58,16 +63,16 @@ print_key(char k[KEYSIZE]) {
 	printf("\n");
 }
 
-void
-populate_bigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE]) {
-	int c0, c1, i, j, n;
+guint64
+populate_bigram_matrix(FILE *f, guint32 m[KEYSIZE][KEYSIZE]) {
+	int c0, c1, i, j;
+	guint64 n = 0;
 
 	/* reset matrix values to 0 */
 	for(i = 0; i<KEYSIZE; i++)
 		for(j=0; j<KEYSIZE; j++)
 			m[i][j] = 0;
 	/* count bigrams occurrences */
-	i = 0;
 	rewind(f);
 	c0 = fgetc(f);
 	c1 = fgetc(f);
@@ -82,21 +87,19 @@ populate_bigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE]) {
 		c0 = tolower(c0);
 		c1 = tolower(c1);
 		m[c0-OFFSET][c1-OFFSET] += 1;
-		i++;
+		n++;
 		c0 = c1;
 		c1 = fgetc(f);
 	}
-	/* get bigram number */
-	n = i;
-	/* generate statistics */
-	for(i=0; i<KEYSIZE; i++)
-		for(j=0; j<KEYSIZE; j++)
-			m[i][j] = m[i][j]/n;
+
+	/* counts are kept as they are, goodness functions normalise */
+	return n;
 }
 
-void
-populate_trigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE][KEYSIZE]) {
-	int c0, c1, c2, i, j, k, n;
+guint64
+populate_trigram_matrix(FILE *f, guint32 m[KEYSIZE][KEYSIZE][KEYSIZE]) {
+	int c0, c1, c2, i, j, k;
+	guint64 n = 0;
 
 	/* reset matrix values to 0 */
 	for(i = 0; i<KEYSIZE; i++)
@@ -104,7 +107,6 @@ populate_trigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE][KEYSIZE]) {
 			for(k=0; k<KEYSIZE; k++)
 				m[i][j][k] = 0;
 	/* count trigrams occurrences */
-	i = 0;
 	rewind(f);
 	c0 = fgetc(f);
 	c1 = fgetc(f);
@@ -122,23 +124,18 @@ populate_trigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE][KEYSIZE]) {
 		c1 = tolower(c1);
 		c2 = tolower(c2);
 		m[c0-OFFSET][c1-OFFSET][c2-OFFSET] += 1;
-		i++;
+		n++;
 		c0 = c1;
 		c1 = c2;
 		c2 = fgetc(f);
 	}
-	/* get trigram number */
-	n = i;
-	/* generate statistics */
-	for(i=0; i<KEYSIZE; i++)
-		for(j=0; j<KEYSIZE; j++)
-			for(k=0; k<KEYSIZE; k++)
-				m[i][j][k] = m[i][j][k]/n;
+
+	return n;
 }
 
 void
-swap_in_bigram_matrix(float m[KEYSIZE][KEYSIZE], int a, int b) {
-	float t;
+swap_in_bigram_matrix(guint32 m[KEYSIZE][KEYSIZE], int a, int b) {
+	guint32 t;
 	int i;
 
 	/* swap columns */
@@ -157,8 +154,8 @@ swap_in_bigram_matrix(float m[KEYSIZE][KEYSIZE], int a, int b) {
 }
 
 void
-swap_in_trigram_matrix(float m[KEYSIZE][KEYSIZE][KEYSIZE], int a, int b) {
-	float t;
+swap_in_trigram_matrix(guint32 m[KEYSIZE][KEYSIZE][KEYSIZE], int a, int b) {
+	guint32 t;
 	int i;
 
 	for(i=0; i<KEYSIZE; i++) {
@@ -179,68 +176,359 @@ swap_in_trigram_matrix(float m[KEYSIZE][KEYSIZE][KEYSIZE], int a, int b) {
 }
 
 void
-copy_bigram_matrix(float m1[KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE]) {
+copy_bigram_matrix(guint32 m1[KEYSIZE][KEYSIZE], guint32 m2[KEYSIZE][KEYSIZE]) {
+	memcpy(m1, m2, KEYSIZE*KEYSIZE*sizeof(guint32));
+}
+
+void
+copy_trigram_matrix(guint32 m1[KEYSIZE][KEYSIZE][KEYSIZE], guint32 m2[KEYSIZE][KEYSIZE][KEYSIZE]) {
+	memcpy(m1, m2, KEYSIZE*KEYSIZE*KEYSIZE*sizeof(guint32));
+}
+
+/* whether the integer sums of n1 and n2 totals fit, see GOODNESS_MAX_PRODUCT */
+static int
+exact_product(guint64 n1, guint64 n2) {
+	return n1 == 0 || n2 <= GOODNESS_MAX_PRODUCT / n1;
+}
+
+/*
+ * l1 distance of the two distributions scaled by n1*n2, so that it can be
+ * summed exactly on integers: sum |m1/n1 - m2/n2| = sum |m1*n2 - m2*n1| / (n1*n2)
+ */
+double
+bigram_goodness(guint32 m1[KEYSIZE][KEYSIZE], guint64 n1, guint32 m2[KEYSIZE][KEYSIZE], guint64 n2) {
+	guint64 x, y, t = 0;
+	double v = 0;
 	int i, j;
 
+	if(!exact_product(n1, n2)) {
+		for(i=0; i<KEYSIZE; i++)
+			for(j=0; j<KEYSIZE; j++)
+				v += fabs((double)m1[i][j] / n1 - (double)m2[i][j] / n2);
+		return v;
+	}
 	for(i=0; i<KEYSIZE; i++)
-		for(j=0; j<KEYSIZE; j++)
-			m1[i][j] = m2[i][j];
+		for(j=0; j<KEYSIZE; j++) {
+			x = m1[i][j] * n2;
+			y = m2[i][j] * n1;
+			t += x > y ? x - y : y - x;
+		}
+
+	/* only the final division is done in floating point */
+	return (double)t / ((double)n1 * n2);
 }
 
-void
-copy_trigram_matrix(float m1[KEYSIZE][KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE][KEYSIZE]) {
+double
+trigram_goodness(guint32 m1[KEYSIZE][KEYSIZE][KEYSIZE], guint64 n1, guint32 m2[KEYSIZE][KEYSIZE][KEYSIZE], guint64 n2) {
+	guint64 x, y, t = 0;
+	double v = 0;
 	int i, j, k;
 
+	if(!exact_product(n1, n2)) {
+		for(i=0; i<KEYSIZE; i++)
+			for(j=0; j<KEYSIZE; j++)
+				for(k=0; k<KEYSIZE; k++)
+					v += fabs((double)m1[i][j][k] / n1 - (double)m2[i][j][k] / n2);
+		return v;
+	}
 	for(i=0; i<KEYSIZE; i++)
 		for(j=0; j<KEYSIZE; j++)
-			for(k=0; k<KEYSIZE; k++)
-				m1[i][j][k] = m2[i][j][k];
+			for(k=0; k<KEYSIZE; k++) {
+				x = m1[i][j][k] * n2;
+				y = m2[i][j][k] * n1;
+				t += x > y ? x - y : y - x;
+			}
+
+	return (double)t / ((double)n1 * n2);
 }
 
-float
-bigram_goodness(float m1[KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE]) {
-	int i, j;
-	float t = 0;
+Model *
+model_new(FILE *fs) {
+	Model *m;
+	Counts *c;
+	int i, j, k;
 
+	/* merged count files carry the same statistics as a sample text */
+	if(is_counts(fs)) {
+		c = counts_new();
+		if(counts_read(c, fs) < 0)
+			die("The sample file is not a valid count file.");
+		m = counts_model(c);
+		counts_free(c);
+	}
+	else {
+		m = malloc(sizeof(Model));
+		guess_key(fs, m->ks);
+		m->nb = populate_bigram_matrix(fs, m->b);
+		m->nt = populate_trigram_matrix(fs, m->t);
+		if(ferror(fs))
+			die("The sample file cannot be read to its end.");
+	}
 	for(i=0; i<KEYSIZE; i++)
 		for(j=0; j<KEYSIZE; j++)
-			t += fabsf(m1[i][j] - m2[i][j]);
+			for(k=0, m->r[i][j] = 0; k<KEYSIZE; k++)
+				m->r[i][j] += m->t[i][j][k];
 
-	return t;
+	return m;
+}
+
+void
+model_free(Model *m) {
+	free(m);
+}
+
+/* solve states are recycled instead of being allocated for every solve */
+static State *pool = NULL;
+static GMutex pool_lock;
+
+State *
+state_new(Model *m, char *key) {
+	State *s;
+
+	g_mutex_lock(&pool_lock);
+	if((s = pool) != NULL)
+		pool = s->next;
+	g_mutex_unlock(&pool_lock);
+	if(s == NULL)
+		s = malloc(sizeof(State));
+	s->model = m;
+	s->key = key;
+	s->evals = s->rejects = s->cells = 0;
+	s->next = NULL;
+
+	return s;
 }
 
-float
-trigram_goodness(float m1[KEYSIZE][KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE][KEYSIZE]) {
+void
+state_load(State *s, FILE *f) {
 	int i, j, k;
-	float t = 0;
 
+	s->nb = populate_bigram_matrix(f, s->b);
+	s->nt = populate_trigram_matrix(f, s->t);
 	for(i=0; i<KEYSIZE; i++)
-		for(j=0; j<KEYSIZE; j++) 
-			for(k=0; k<KEYSIZE; k++) 
-				t += fabsf(m1[i][j][k] - m2[i][j][k]);
-	return t;
+		for(j=0; j<KEYSIZE; j++)
+			for(k=0, s->r[i][j] = 0; k<KEYSIZE; k++)
+				s->r[i][j] += s->t[i][j][k];
+}
+
+void
+state_load_buffer(State *s, const char *buf, long n) {
+	int a, b, c;
+	long i;
+
+	/* same counting as the populate functions, on lowercase text in memory */
+	memset(s->b, 0, sizeof(s->b));
+	memset(s->t, 0, sizeof(s->t));
+	memset(s->r, 0, sizeof(s->r));
+	s->nb = 0;
+	s->nt = 0;
+	for(i=0; i+1<n; i++) {
+		if(!islower((unsigned char)buf[i]) || !islower((unsigned char)buf[i+1]))
+			continue;
+		a = buf[i]-OFFSET;
+		b = buf[i+1]-OFFSET;
+		s->b[a][b]++;
+		s->nb++;
+		if(i+2 < n && islower((unsigned char)buf[i+2])) {
+			c = buf[i+2]-OFFSET;
+			s->t[a][b][c]++;
+			s->r[a][b]++;
+			s->nt++;
+		}
+	}
+}
+
+void
+state_copy(State *s1, State *s2) {
+	copy_bigram_matrix(s1->b, s2->b);
+	copy_trigram_matrix(s1->t, s2->t);
+	copy_bigram_matrix(s1->r, s2->r);
+	s1->nb = s2->nb;
+	s1->nt = s2->nt;
+}
+
+void
+state_free(State *s) {
+	g_mutex_lock(&pool_lock);
+	s->next = pool;
+	pool = s;
+	g_mutex_unlock(&pool_lock);
+}
+
+void
+state_pool_clear(void) {
+	State *s;
+
+	g_mutex_lock(&pool_lock);
+	while((s = pool) != NULL) {
+		pool = s->next;
+		free(s);
+	}
+	g_mutex_unlock(&pool_lock);
+}
+
+double
+state_goodness(State *s) {
+	Model *m = s->model;
+	double v = 0;
+
+	if(s->nb > 0 && m->nb > 0)
+		v += bigram_goodness(s->b, s->nb, m->b, m->nb);
+	if(s->nt > 0 && m->nt > 0)
+		v += trigram_goodness(s->t, s->nt, m->t, m->nt);
+
+	return v;
+}
+
+/*
+ * state_goodness() cut short once it reaches bound. Cells summing up to x
+ * and y differ by at least |x - y| in all, so the sums of the bigrams and
+ * of every trigram row left bound the distance still to come from below;
+ * the cells go by reference frequency, most of the distance first
+ */
+double
+state_bounded_goodness(State *s, double bound) {
+	Model *m = s->model;
+	guint64 x, y, tb = 0, tt = 0, rest = 0, lb[KEYSIZE][KEYSIZE];
+	gint64 d = 0;
+	guint32 *r1, *r2;
+	double vb = 0, db, dt;
+	int i, j, k, o[KEYSIZE];
+
+	s->evals++;
+	/* totals too large for the integer sums are scored in full */
+	if(!exact_product(s->nb, m->nb) || !exact_product(s->nt, m->nt))
+		return state_goodness(s);
+	for(i=0; i<KEYSIZE; i++)
+		o[i] = m->ks[i]-OFFSET;
+	if(s->nb > 0 && m->nb > 0) {
+		db = (double)s->nb * m->nb;
+		for(i=0; i<KEYSIZE; i++) {
+			for(j=0; j<KEYSIZE; j++) {
+				x = s->b[o[i]][o[j]] * m->nb;
+				y = m->b[o[i]][o[j]] * s->nb;
+				tb += x > y ? x - y : y - x;
+				d += (gint64)(x - y);
+			}
+			s->cells += KEYSIZE;
+			if((double)(tb + (d < 0 ? -d : d)) / db >= bound) {
+				s->rejects++;
+				return (double)(tb + (d < 0 ? -d : d)) / db;
+			}
+		}
+		vb = (double)tb / db;
+	}
+	if(s->nt == 0 || m->nt == 0)
+		return vb;
+	dt = (double)s->nt * m->nt;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			x = s->r[i][j] * m->nt;
+			y = m->r[i][j] * s->nt;
+			lb[i][j] = x > y ? x - y : y - x;
+			rest += lb[i][j];
+		}
+	s->cells += KEYSIZE*KEYSIZE;
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++) {
+			if(vb + (double)(tt + rest) / dt >= bound) {
+				s->rejects++;
+				return vb + (double)(tt + rest) / dt;
+			}
+			/* a row is contiguous, only rows are taken out of order */
+			r1 = s->t[o[i]][o[j]];
+			r2 = m->t[o[i]][o[j]];
+			for(k=0; k<KEYSIZE; k++) {
+				x = r1[k] * m->nt;
+				y = r2[k] * s->nt;
+				tt += x > y ? x - y : y - x;
+			}
+			rest -= lb[o[i]][o[j]];
+			s->cells += KEYSIZE;
+		}
+
+	return vb + (double)tt / dt;
+}
+
+/* swap_in_trigram_matrix() moving the row sums along with the cells */
+static void
+swap_in_trigram_rows(guint32 m[KEYSIZE][KEYSIZE][KEYSIZE], guint32 r[KEYSIZE][KEYSIZE], int a, int b) {
+	guint32 t;
+	int i;
+
+	for(i=0; i<KEYSIZE; i++) {
+		t = m[i][a][b];
+		r[i][a] += m[i][b][a] - t;
+		r[i][b] += t - m[i][b][a];
+		m[i][a][b] = m[i][b][a];
+		m[i][b][a] = t;
+	}
+	for(i=0; i<KEYSIZE; i++) {
+		t = m[a][i][b];
+		r[a][i] += m[b][i][a] - t;
+		r[b][i] += t - m[b][i][a];
+		m[a][i][b] = m[b][i][a];
+		m[b][i][a] = t;
+	}
+	for(i=0; i<KEYSIZE; i++) {
+		t = m[a][b][i];
+		m[a][b][i] = m[b][a][i];
+		m[b][a][i] = t;
+	}
+	t = r[a][b];
+	r[a][b] = r[b][a];
+	r[b][a] = t;
+}
+
+void
+state_swap(State *s, int a, int b) {
+	swap_in_bigram_matrix(s->b, s->key[a]-OFFSET, s->key[b]-OFFSET);
+	swap_in_trigram_rows(s->t, s->r, s->key[a]-OFFSET, s->key[b]-OFFSET);
 }
 
+/* the sample words word_goodness() counts as hits, those seen more than once */
+GHashTable *
+dictionary_new(GList *slist) {
+	GHashTable *dict;
+	GList *iter;
+
+	dict = g_hash_table_new(g_str_hash, g_str_equal);
+	for(iter = g_list_first(slist); iter != NULL && ((Word *)iter->data)->occ > 1; iter = iter->next)
+		g_hash_table_insert(dict, ((Word *)iter->data)->word, iter->data);
+
+	return dict;
+}
+
+/*
+ * distinct words of fi decrypted with key, cut like count_words() does,
+ * found in dict; one pass, without the file of decrypt_to_file()
+ */
 int
-word_goodness(GList *l1, GList *l2) {
-        GList *iter1;
-        GList *iter2;
-        int t = 0;
-
-        iter1 = g_list_first(l1);
-        while(iter1 != NULL) {
-                iter2 = g_list_first(l2);
-                while(iter2 != NULL && ((Word *)iter2->data)->occ > 1) {
-                        if(strcmp(((Word *)iter1->data)->word, ((Word *)iter2->data)->word) == 0) {
-				t += 1;
-                                break;
-                        }
-                        iter2 = iter2->next;
-                }
-                iter1 = iter1->next;
-        }
-
-        return t;
+word_goodness(FILE *fi, const char *ks, const char *key, GHashTable *dict) {
+	GHashTable *seen;
+	char map[N], buf[N];
+	int c, i, t = 0;
+
+	for(i=0; i<N; i++)
+		map[i] = tolower(i);
+	for(i=0; i<KEYSIZE; i++)
+		map[(unsigned char)ks[i]] = map[toupper(ks[i])] = key[i];
+	seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	rewind(fi);
+	while((c = fgetc(fi)) != EOF) {
+		for(i=0; isalpha(c) && i <= N-2; c = fgetc(fi))
+			buf[i++] = map[c];
+		if(i == 0)
+			continue;
+		buf[i] = '\0';
+		if(!g_hash_table_contains(seen, buf)) {
+			g_hash_table_insert(seen, g_strdup(buf), NULL);
+			t += g_hash_table_contains(dict, buf);
+		}
+	}
+	g_hash_table_destroy(seen);
+
+	return t;
 }
 
 char *
@@ -295,154 +583,253 @@ echo_file(FILE *f) {
 }
 
 void
-decrypt(FILE *fi, FILE *fs) {
-        FILE *fptr;
-        char *fname;
-	float v = 0, v1 = 0, vt = 0, vt1 = 0;
-	int a = 0, b = 1, i = 0;
-
-	float Db[KEYSIZE][KEYSIZE];
-	float Eb[KEYSIZE][KEYSIZE];
-	float Db1[KEYSIZE][KEYSIZE];
-	float Dt[KEYSIZE][KEYSIZE][KEYSIZE];
-	float Et[KEYSIZE][KEYSIZE][KEYSIZE];
-	float Dt1[KEYSIZE][KEYSIZE][KEYSIZE];
-	char ks[KEYSIZE];
-	char key[KEYSIZE];
-	char k1[KEYSIZE];
-
-	GList *input_wlist = NULL;
-	GList *input_slist = NULL;
-	char loader[] = "|/-\\|";
-	int case_sensitive = 0; /* no case sensitive */
-
-	guess_key(fs, ks);
-	guess_key(fi, key);
-
+print_result(FILE *fi, char *ks, char *key) {
+	char *fname;
+	FILE *fptr;
+
+	printf("\rdone!\n\nThe mapping found is:\n\n\t<- ");
+	print_key(ks);
+	printf("\t   ||||||||||||||||||||||||||\n");
+	printf("\t-> ");
+	print_key(key);
+	printf("\nDecryption result:\n\n");
 	fname = decrypt_to_file(fi, ks, key);
 	fptr = fopen(fname, "r");
-	populate_bigram_matrix(fptr, Db);
-	populate_trigram_matrix(fptr, Dt);
+	echo_file(fptr);
 	fclose(fptr);
+	remove(fname);
+	putchar('\n');
+}
 
-	populate_bigram_matrix(fs, Eb);
-	populate_trigram_matrix(fs, Et);
-	
-	v = bigram_goodness(Db, Eb);
-	vt = trigram_goodness(Dt, Et);
-	copy_bigram_matrix(Db1, Db);
-	copy_trigram_matrix(Dt1, Dt);
-	copy_key(k1, key);
-        printf("Decripting using bigram and trigram detection...\n");
-	while(1) {
-                printf("\r%c", loader[i++ % 5]);
-
-		swap_in_key(k1, a, a+b);
-		swap_in_bigram_matrix(Db1, k1[a]-OFFSET, k1[a+b]-OFFSET);
-		swap_in_trigram_matrix(Dt1, k1[a]-OFFSET, k1[a+b]-OFFSET);
-
-		a = a+1;
-		if(a+b > KEYSIZE-1) {
-			a = 0;
-			b = b+1;
-			if(b == KEYSIZE-1) {
-				printf("\rdone!\n\nThe mapping found is:\n\n\t<- ");
-				print_key(ks);
-				printf("\t   ||||||||||||||||||||||||||\n");
-				printf("\t-> ");
-				print_key(key);
-				printf("\nDecryption result:\n\n");
-				fname = decrypt_to_file(fi, ks, key);
-				fptr = fopen(fname, "r");
-				echo_file(fptr);
-				fclose(fptr);
-				remove(fname);
-				putchar('\n');
-				break;
-			}
-		}
-		
-		v1 = bigram_goodness(Db1, Eb);
-		vt1 = trigram_goodness(Dt1, Et);
-		if(v1+vt1 < v+vt) {
-			a = 0;
-			b = 1;
-			v = v1;
-			vt = vt1;
-			copy_key(key, k1);
-			copy_bigram_matrix(Db, Db1);
-			copy_trigram_matrix(Dt, Dt1);
-		}
-		else {
-			copy_key(k1, key);
-			copy_bigram_matrix(Db1, Db);
-			copy_trigram_matrix(Dt1, Dt);
-		}
+double
+ngram_score(void *ctx, int a, int b, double bound) {
+	State *s = ctx;
+	double v;
+
+	/* the swap is an involution, undoing it restores the counts */
+	state_swap(s, a, b);
+	v = state_bounded_goodness(s, bound);
+	state_swap(s, a, b);
+
+	return v;
+}
+
+double
+word_score(void *ctx, int a, int b, double bound) {
+	Dictionary *d = ctx;
+	int w;
+
+	(void)bound;
+	swap_in_key(d->key, a, b);
+	w = word_goodness(d->fi, d->ks, d->key, d->dict);
+	swap_in_key(d->key, a, b);
+
+	/* more dictionary words is better, the sweep wants lower */
+	return -(double)w;
+}
+
+/*
+ * put the plain letters of map, by cipher letter, in place in key; locked,
+ * unless NULL, gets which ones are set. decrypt_to_file() turns ks[i] into key[i]
+ */
+int
+seed_key(const char *map, const char *ks, char *key, char *locked) {
+	int i, j, n = 0;
+
+	for(i=0; i<KEYSIZE; i++) {
+		if(locked != NULL)
+			locked[i] = map[ks[i]-OFFSET] != 0;
+		if(map[ks[i]-OFFSET] == 0)
+			continue;
+		for(j=0; key[j] != map[ks[i]-OFFSET]; j++)
+			;
+		swap_in_key(key, i, j);
+		n++;
 	}
-	fname = decrypt_to_file(fi, ks, key);
+
+	return n;
+}
+
+double
+climb_ngrams(FILE *fi, Model *model, char *key, Search *search, struct Budget *budget, int verbose) {
+	FILE *fptr;
+	char *fname;
+	double v, v1;
+	int a, i = 0, j, n, ncand;
+	guint64 evals = 0, rejects = 0, cells = 0;
+	long hits, misses;
+	State **g;
+	Sweep *sw;
+	Cache *cache;
+	Swap cand[KEYSIZE*(KEYSIZE-1)/2];
+	char locked[KEYSIZE];
+	char loader[] = "|/-\\|";
+
+	seed_key(search->fixed, model->ks, key, locked);
+	/* every thread scores candidates on its own copy of the counts */
+	n = search->threads < 1 ? 1 : search->threads;
+	g = malloc(n * sizeof(State *));
+	g[0] = state_new(model, key);
+	fname = decrypt_to_file(fi, model->ks, key);
 	fptr = fopen(fname, "r");
-	input_wlist = count_words(fptr, input_wlist, case_sensitive);
+	state_load(g[0], fptr);
 	fclose(fptr);
-	input_slist = count_words(fs, input_slist, case_sensitive);
+	remove(fname);
+	for(j=1; j<n; j++) {
+		g[j] = state_new(model, key);
+		state_copy(g[j], g[0]);
+	}
+	sw = sweep_new(n, ngram_score, (void **)g);
+	cache = cache_new(KEYSIZE, CACHE_BITS);
+	sweep_cache(sw, cache, key);
+	sweep_budget(sw, budget);
+	ncand = drop_locked(cand, neighbourhood(cand, KEYSIZE), locked);
+
+	v = state_goodness(g[0]);
+	while((j = sweep_run(sw, cand, ncand, search->policy, v, &v1)) >= 0) {
+		if(verbose)
+			printf("\r%c", loader[i++ % 5]);
+		v = v1;
+		for(a=0; a<n; a++)
+			state_swap(g[a], cand[j].a, cand[j].b);
+		swap_in_key(key, cand[j].a, cand[j].b);
+	}
+	sweep_free(sw);
+	hits = cache->hits;
+	misses = cache->misses;
+	cache_free(cache);
+	for(j=0; j<n; j++) {
+		evals += g[j]->evals;
+		rejects += g[j]->rejects;
+		cells += g[j]->cells;
+		state_free(g[j]);
+	}
+	free(g);
+	/* how much of the n-gram tables the bounds saved summing */
+	if(verbose && evals > 0)
+		printf("\r%ld of %ld scores rejected early, %.1f%% of the cells summed\n",
+			(long)rejects, (long)evals, 100.0 * cells / (evals * (KEYSIZE*KEYSIZE + KEYSIZE*KEYSIZE*KEYSIZE)));
+	if(verbose && hits + misses > 0)
+		printf("%ld of %ld lookups found in the score cache\n", hits, hits + misses);
+
+	return v;
+}
 
-	int w = 0, w1 = 0;
+int
+climb_words(FILE *fi, char *ks, GList *slist, char *key, Search *search, struct Budget *budget, int verbose) {
+	double v, v1;
+	int i = 0, j, ncand;
+	Sweep *sw;
+	Cache *cache;
+	Dictionary dict;
+	void *ctx;
+	Swap cand[KEYSIZE*(KEYSIZE-1)/2];
+	char locked[KEYSIZE];
+	char loader[] = "|/-\\|";
 
-	w = word_goodness(input_wlist, input_slist);
-	free_list(input_wlist);
-	input_wlist = NULL;
+	seed_key(search->fixed, ks, key, locked);
+	dict.fi = fi;
+	dict.ks = ks;
+	dict.key = key;
+	dict.dict = dictionary_new(slist);
+	v = word_score(&dict, 0, 0, HUGE_VAL);
+	budget->evals++;
+
+	/* every score costs a full decryption, a single thread will do */
+	ctx = &dict;
+	sw = sweep_new(1, word_score, &ctx);
+	cache = cache_new(KEYSIZE, CACHE_BITS);
+	sweep_cache(sw, cache, key);
+	sweep_budget(sw, budget);
+	ncand = drop_locked(cand, neighbourhood(cand, KEYSIZE), locked);
+	while((j = sweep_run(sw, cand, ncand, search->policy, v, &v1)) >= 0) {
+		if(verbose)
+			printf("\r%c", loader[i++ % 5]);
+		v = v1;
+		swap_in_key(key, cand[j].a, cand[j].b);
+	}
+	sweep_free(sw);
+	cache_free(cache);
+	g_hash_table_destroy(dict.dict);
 
-	copy_key(k1, key);
-	
-	a = 0;
-	b = 1;
+	return -v;
+}
 
-	printf("Affining result with dictionary-based decryption...\n");
-	while(1) {
-		printf("\r%c", loader[i++ % 5]);
-
-                swap_in_key(k1, a, a+b);
-
-                a = a+1;
-                if(a+b > KEYSIZE-1) {
-                        a = 0;
-                        b = b+1;
-                        if(b == KEYSIZE-1) {
-                                printf("\rdone!\n\nThe mapping found is:\n\n\t<- ");
-                                print_key(ks);
-                                printf("\t   ||||||||||||||||||||||||||\n");
-                                printf("\t-> ");
-                                print_key(key);
-                                printf("\nDecryption result:\n\n");
-                                decrypt_to_file(fi, ks, key);
-                                fptr = fopen(fname, "r");
-                                echo_file(fptr);
-                                fclose(fptr);
-                                putchar('\n');
-                                break;
-                        }
-                }
-
-		fname = decrypt_to_file(fi, ks, k1);
-		fptr = fopen(fname, "r");
-		input_wlist = count_words(fptr, input_wlist, case_sensitive);
-		fclose(fptr);
-		
-		w1 = word_goodness(input_wlist, input_slist);
-		free_list(input_wlist);
-		input_wlist = NULL;
-
-                if(w1 > w) {
-                        a = 0;
-                        b = 1;
-                        w = w1;
-                        copy_key(key, k1);
-                }
-                else {
-                        copy_key(k1, key);
-                }
+void
+decrypt(FILE *fi, FILE *fs, Search *search) {
+	double v;
+	int w;
+	char *ks;
+	char key[KEYSIZE];
+	char map[KEYSIZE];
+	char locked[KEYSIZE];
+	Model *model;
+	Budget budget;
+	PatternIndex *idx;
+	Segmenter *seg;
+	GList *input_slist = NULL;
+
+	/* the limits bound the whole run, loading the sample too */
+	budget_begin(&budget, search->time_limit, search->max_evals);
+	/* the reference side is read only and shared by every thread */
+	model = model_new(fs);
+	ks = model->ks;
+	guess_key(fi, key);
+	if(search->patterns) {
+		/* start climbing from the word pattern solution */
+		printf("Seeding the key with word patterns...\n");
+		idx = pattern_index_new(fs);
+		memcpy(map, search->fixed, KEYSIZE);
+		solve_patterns(idx, fi, map);
+		pattern_index_free(idx);
+		seed_key(map, ks, key, NULL);
 	}
+	if(seed_key(search->fixed, ks, key, locked) > 0)
+		printf("Searching the remaining letters only...\n");
+
+        printf("Decripting using bigram and trigram detection...\n");
+	v = climb_ngrams(fi, model, key, search, &budget, 1);
+	if(budget.stopped) {
+		/* anytime search, the best key so far is the answer */
+		printf("\rstopped, %s after %ld evaluations, n-gram score %f\n", budget_reason(&budget), budget.evals, v);
+		print_result(fi, ks, key);
+		budget_end(&budget);
+		model_free(model);
+	state_pool_clear();
+		return;
+	}
+	print_result(fi, ks, key);
+
+	input_slist = sample_words(fs);
+	if(budget_exhausted(&budget)) {
+		printf("stopped, %s before the dictionary phase\n", budget_reason(&budget));
+		budget_end(&budget);
+		free_list(input_slist);
+		model_free(model);
+	state_pool_clear();
+		return;
+	}
+	if(search->segment || needs_segmentation(fi)) {
+		/* no word boundaries to count words with, find them */
+		printf("Affining result with dictionary-based segmentation...\n");
+		seg = segmenter_new(input_slist);
+		v = climb_segments(fi, ks, seg, key, search, &budget, 1);
+		if(budget.stopped)
+			printf("\rstopped, %s after %ld evaluations, log probability %f\n", budget_reason(&budget), budget.evals, v);
+		print_result(fi, ks, key);
+		print_segmentation(seg, fi, ks, key);
+		segmenter_free(seg);
+	}
+	else {
+		printf("Affining result with dictionary-based decryption...\n");
+		w = climb_words(fi, ks, input_slist, key, search, &budget, 1);
+		if(budget.stopped)
+			printf("\rstopped, %s after %ld evaluations, %d dictionary words\n", budget_reason(&budget), budget.evals, w);
+		print_result(fi, ks, key);
+	}
+	budget_end(&budget);
 
-	remove(fname);
-	free_list(input_wlist);
 	free_list(input_slist);
+	model_free(model);
+	state_pool_clear();
 }
@@ -7,20 +7,101 @@
 #define KEYSIZE 26
 #define OFFSET  97
 
+/* structs */
+typedef struct {
+	int threads;
+	int policy;
+	int patterns;
+	/* anytime limits, zero means none */
+	double time_limit;
+	long max_evals;
+	/* known plain letter of every cipher letter, 0 when unknown */
+	char fixed[KEYSIZE];
+	/* score keys by word segmentation instead of delimited words */
+	int segment;
+	/* bytes of the first sample of a progressive solve, 0 for none */
+	long progressive;
+} Search;
+
+/*
+ * the goodness functions sum |m1*n2 - m2*n1| on 64 bit integers, reaching
+ * 4*n1*n2 at most with the row bounds; totals with a larger product, about
+ * 2G n-grams on both sides, are compared on doubles instead
+ */
+#define GOODNESS_MAX_PRODUCT	(G_MAXUINT64 >> 2)
+
+/* reference statistics, built once and shared read only */
+typedef struct {
+	guint32 b[KEYSIZE][KEYSIZE];
+	guint32 t[KEYSIZE][KEYSIZE][KEYSIZE];
+	guint64 nb;
+	guint64 nt;
+	char ks[KEYSIZE];
+	/* trigrams summed over their last letter */
+	guint64 r[KEYSIZE][KEYSIZE];
+} Model;
+
+/* ciphertext n-gram counts under the current key, one per thread */
+typedef struct State {
+	guint32 b[KEYSIZE][KEYSIZE];
+	guint32 t[KEYSIZE][KEYSIZE][KEYSIZE];
+	guint64 nb;
+	guint64 nt;
+	/* as in Model, kept up to date by every swap */
+	guint32 r[KEYSIZE][KEYSIZE];
+	Model *model;
+	char *key;
+	/* bounded scores, rejected ones and n-gram cells summed */
+	guint64 evals;
+	guint64 rejects;
+	guint64 cells;
+	struct State *next;
+} State;
+
+/* dictionary phase scoring context */
+typedef struct {
+	FILE *fi;
+	char *ks;
+	char *key;
+	/* sample words seen more than once, see dictionary_new() */
+	GHashTable *dict;
+} Dictionary;
+
+/* search limits, see sweep.h */
+struct Budget;
+
 /* function declarations */
 void guess_key(FILE *f, char k[KEYSIZE]);
 void swap_in_key(char *k, int a, int b);
 void copy_key(char key1[KEYSIZE], char key2[KEYSIZE]);
 void print_key(char k[KEYSIZE]);
-void populate_bigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE]);
-void populate_trigram_matrix(FILE *f, float m[KEYSIZE][KEYSIZE][KEYSIZE]);
-void swap_in_bigram_matrix(float m[KEYSIZE][KEYSIZE], int a, int b);
-void swap_in_trigram_matrix(float m[KEYSIZE][KEYSIZE][KEYSIZE], int a, int b);
-void copy_bigram_matrix(float m1[KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE]);
-void copy_trigram_matrix(float m1[KEYSIZE][KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE][KEYSIZE]);
+guint64 populate_bigram_matrix(FILE *f, guint32 m[KEYSIZE][KEYSIZE]);
+guint64 populate_trigram_matrix(FILE *f, guint32 m[KEYSIZE][KEYSIZE][KEYSIZE]);
+void swap_in_bigram_matrix(guint32 m[KEYSIZE][KEYSIZE], int a, int b);
+void swap_in_trigram_matrix(guint32 m[KEYSIZE][KEYSIZE][KEYSIZE], int a, int b);
+void copy_bigram_matrix(guint32 m1[KEYSIZE][KEYSIZE], guint32 m2[KEYSIZE][KEYSIZE]);
+void copy_trigram_matrix(guint32 m1[KEYSIZE][KEYSIZE][KEYSIZE], guint32 m2[KEYSIZE][KEYSIZE][KEYSIZE]);
+Model *model_new(FILE *fs);
+void model_free(Model *m);
+State *state_new(Model *m, char *key);
+void state_load(State *s, FILE *f);
+void state_load_buffer(State *s, const char *buf, long n);
+void state_copy(State *s1, State *s2);
+void state_free(State *s);
+void state_pool_clear(void);
+double state_goodness(State *s);
+double state_bounded_goodness(State *s, double bound);
+void state_swap(State *s, int a, int b);
 void echo_file(FILE *f);
-void decrypt(FILE *fi, FILE *fs);
-float bigram_goodness(float m1[KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE]);
-float trigram_goodness(float m1[KEYSIZE][KEYSIZE][KEYSIZE], float m2[KEYSIZE][KEYSIZE][KEYSIZE]);
-int word_goodness(GList *l1, GList *l2);
+void print_result(FILE *fi, char *ks, char *key);
+double ngram_score(void *ctx, int a, int b, double bound);
+double word_score(void *ctx, int a, int b, double bound);
+int seed_key(const char *map, const char *ks, char *key, char *locked);
+double climb_ngrams(FILE *fi, Model *model, char *key, Search *search, struct Budget *budget, int verbose);
+int climb_words(FILE *fi, char *ks, GList *slist, char *key, Search *search, struct Budget *budget, int verbose);
+void decrypt(FILE *fi, FILE *fs, Search *search);
+double bigram_goodness(guint32 m1[KEYSIZE][KEYSIZE], guint64 n1, guint32 m2[KEYSIZE][KEYSIZE], guint64 n2);
+double trigram_goodness(guint32 m1[KEYSIZE][KEYSIZE][KEYSIZE], guint64 n1, guint32 m2[KEYSIZE][KEYSIZE][KEYSIZE], guint64 n2);
+GHashTable *dictionary_new(GList *slist);
+int word_goodness(FILE *fi, const char *ks, const char *key, GHashTable *dict);
 char *decrypt_to_file(FILE *fi, char *k1, char *k2);
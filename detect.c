@@ -0,0 +1,297 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: detect.c, language detection. The ciphertext is reduced to
+ * 		statistics a substitution can not change (sorted letter
+ * 		frequencies, index of coincidence, word patterns) and compared
+ * 		against every language profile and sample model.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "pattern.h"
+#include "detect.h"
+
+typedef struct {
+	Profile *p;
+	int n;
+	int id;
+	int nthreads;
+} Job;
+
+/* function implementations */
+static int
+by_freq(const void *x, const void *y) {
+	double a = *(const double *)x, b = *(const double *)y;
+
+	return a < b ? 1 : (a > b ? -1 : 0);
+}
+
+static int
+by_distance(const void *x, const void *y) {
+	const Profile *a = x, *b = y;
+
+	if(a->model != b->model)
+		return a->model - b->model;
+	if(a->distance != b->distance)
+		return a->distance < b->distance ? -1 : 1;
+	return strcmp(a->path, b->path);
+}
+
+static void
+add_pattern(Profile *p, char *w, int len) {
+	char pat[N];
+	gpointer v;
+
+	w[len] = '\0';
+	word_pattern(w, pat);
+	v = g_hash_table_lookup(p->patterns, pat);
+	if(v == NULL)
+		g_hash_table_insert(p->patterns, g_strdup(pat), GINT_TO_POINTER(1));
+	else
+		g_hash_table_insert(p->patterns, g_strdup(pat), GINT_TO_POINTER(GPOINTER_TO_INT(v)+1));
+	p->words++;
+}
+
+void
+profile_text(FILE *f, Profile *p) {
+	long occ[KEYSIZE] = {0}, n = 0;
+	char seen[N] = {'\0'};
+	char order[KEYSIZE];
+	char w[N];
+	int c, i, len = 0;
+
+	p->patterns = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	p->words = 0;
+	p->alphabet = 0;
+	rewind(f);
+	while((c = fgetc(f)) != EOF) {
+		/* utf-8 lead bytes stand for a whole symbol */
+		if((c & 0xC0) == 0xC0 || (isalpha(c) && c < 0x80)) {
+			if(!seen[(unsigned char)tolower(c)])
+				p->alphabet++;
+			seen[(unsigned char)tolower(c)] = 1;
+		}
+		if(c < 0x80 && isalpha(c)) {
+			c = tolower(c);
+			occ[c-OFFSET]++;
+			n++;
+			if(len < N-1)
+				w[len++] = c;
+			continue;
+		}
+		if(len > 0)
+			add_pattern(p, w, len);
+		len = 0;
+	}
+	if(len > 0)
+		add_pattern(p, w, len);
+	/* index of coincidence and the sorted frequency profile */
+	p->ioc = 0;
+	for(i=0; i<KEYSIZE; i++) {
+		p->ioc += n > 1 ? (double)occ[i] * (occ[i]-1) / ((double)n * (n-1)) : 0;
+		p->freq[i] = n > 0 ? (double)occ[i] / n : 0;
+	}
+	qsort(p->freq, KEYSIZE, sizeof(double), by_freq);
+	/* letter ranks, to match a plaintext model against a -l ordering */
+	guess_key(f, order);
+	for(i=0; i<KEYSIZE; i++)
+		p->rank[order[i]-OFFSET] = i;
+}
+
+void
+profile_lang(FILE *f, Profile *p) {
+	int c, i;
+
+	/* a language file is an ordering of its symbols and nothing more */
+	p->patterns = NULL;
+	p->alphabet = 0;
+	for(i=0; i<KEYSIZE; i++)
+		p->rank[i] = -1;
+	rewind(f);
+	while((c = fgetc(f)) != EOF) {
+		if((c & 0xC0) == 0x80 || isspace(c))
+			continue;
+		if(c < 0x80 && isalpha(c) && p->rank[tolower(c)-OFFSET] < 0)
+			p->rank[tolower(c)-OFFSET] = p->alphabet;
+		p->alphabet++;
+	}
+}
+
+void
+free_profile(Profile *p) {
+	if(p->patterns != NULL)
+		g_hash_table_destroy(p->patterns);
+	p->patterns = NULL;
+}
+
+double
+text_distance(Profile *c, Profile *m) {
+	GHashTableIter iter;
+	gpointer k, v, w;
+	double d = 0, pc, pm, seen = 0;
+	int i;
+
+	for(i=0; i<KEYSIZE; i++)
+		d += fabs(c->freq[i] - m->freq[i]);
+	d += IOC_WEIGHT * fabs(c->ioc - m->ioc);
+	if(c->words == 0 || m->words == 0)
+		return d;
+	/* l1 distance of the word pattern distributions */
+	g_hash_table_iter_init(&iter, c->patterns);
+	while(g_hash_table_iter_next(&iter, &k, &v)) {
+		w = g_hash_table_lookup(m->patterns, k);
+		pc = (double)GPOINTER_TO_INT(v) / c->words;
+		pm = (double)GPOINTER_TO_INT(w) / m->words;
+		d += PATTERN_WEIGHT * fabs(pc - pm);
+		seen += pm;
+	}
+	d += PATTERN_WEIGHT * (seen < 1 ? 1 - seen : 0);
+
+	return d;
+}
+
+double
+lang_distance(Profile *c, Profile *m, Profile *l) {
+	double d = 0;
+	int i;
+
+	/*
+	 * the ciphertext hides the letters, so the ordering is compared with
+	 * the closest model instead: normalised footrule distance of the ranks
+	 */
+	for(i=0; i<KEYSIZE; i++)
+		d += l->rank[i] < 0 ? KEYSIZE : abs(m->rank[i] - l->rank[i]);
+	d /= KEYSIZE * KEYSIZE / 2;
+	/* a profile can not have fewer symbols than the ciphertext uses */
+	if(c->alphabet > l->alphabet)
+		d += (double)(c->alphabet - l->alphabet) / c->alphabet;
+
+	return d;
+}
+
+static gpointer
+profile_worker(gpointer data) {
+	Job *j = data;
+	FILE *f;
+	int i;
+
+	for(i=j->id; i<j->n; i+=j->nthreads) {
+		if((f = fopen(j->p[i].path, "r")) == NULL) {
+			j->p[i].patterns = NULL;
+			j->p[i].distance = HUGE_VAL;
+			continue;
+		}
+		if(j->p[i].model)
+			profile_text(f, &j->p[i]);
+		else
+			profile_lang(f, &j->p[i]);
+		fclose(f);
+	}
+
+	return NULL;
+}
+
+static int
+list_dir(const char *dir, int model, Profile **p, int n) {
+	const gchar *name;
+	gchar *path;
+	GDir *d;
+
+	if((d = g_dir_open(dir, 0, NULL)) == NULL)
+		return n;
+	while((name = g_dir_read_name(d)) != NULL) {
+		path = g_build_filename(dir, name, NULL);
+		if(g_file_test(path, G_FILE_TEST_IS_REGULAR) && strlen(path) < N) {
+			*p = realloc(*p, (n+1) * sizeof(Profile));
+			strcpy((*p)[n].path, path);
+			(*p)[n].model = model;
+			(*p)[n].patterns = NULL;
+			n++;
+		}
+		g_free(path);
+	}
+	g_dir_close(d);
+
+	return n;
+}
+
+int
+detect_language(FILE *fi, int nthreads, char *lang, char *sample) {
+	Profile cipher, *p = NULL;
+	GThread **threads;
+	Job *jobs;
+	int i, n, best = -1;
+
+	n = list_dir(LANGUAGES_DIR, 0, &p, 0);
+	n = list_dir(SAMPLES_DIR, 1, &p, n);
+	if(n == 0)
+		return 0;
+	if(nthreads < 1)
+		nthreads = 1;
+	if(nthreads > n)
+		nthreads = n;
+	profile_text(fi, &cipher);
+	/* profile every candidate in parallel, the ciphertext only once */
+	threads = malloc(nthreads * sizeof(GThread *));
+	jobs = malloc(nthreads * sizeof(Job));
+	for(i=0; i<nthreads; i++) {
+		jobs[i].p = p;
+		jobs[i].n = n;
+		jobs[i].id = i;
+		jobs[i].nthreads = nthreads;
+		threads[i] = g_thread_new("detect", profile_worker, &jobs[i]);
+	}
+	for(i=0; i<nthreads; i++)
+		g_thread_join(threads[i]);
+	for(i=0; i<n; i++) {
+		if(p[i].model && p[i].patterns != NULL)
+			p[i].distance = text_distance(&cipher, &p[i]);
+		else
+			p[i].distance = HUGE_VAL;
+		if(p[i].model && (best < 0 || p[i].distance < p[best].distance))
+			best = i;
+	}
+	for(i=0; i<n; i++) {
+		if(!p[i].model && best >= 0 && p[i].alphabet > 0)
+			p[i].distance = lang_distance(&cipher, &p[best], &p[i]);
+		else if(!p[i].model)
+			p[i].distance = HUGE_VAL;
+	}
+	for(i=0; i<n; i++)
+		free_profile(&p[i]);
+	qsort(p, n, sizeof(Profile), by_distance);
+
+	printf("%15s | %-36s |\n%s\n", "Distance", "Language profile (-l) / model (-m)",
+		"--------------------------------------------------------");
+	for(i=0; i<n; i++) {
+		if(i > 0 && p[i].model != p[i-1].model)
+			printf("%15s | %-36s |\n", "", "");
+		printf("%15.6f | %-36s |\n", p[i].distance, p[i].path);
+	}
+	putchar('\n');
+	/* hand the best candidates over to the decryption */
+	for(i=0; i<n; i++)
+		if(!p[i].model && lang != NULL) {
+			strcpy(lang, p[i].path);
+			break;
+		}
+	for(i=0; i<n; i++)
+		if(p[i].model && sample != NULL) {
+			strcpy(sample, p[i].path);
+			break;
+		}
+	free_profile(&cipher);
+	free(threads);
+	free(jobs);
+	free(p);
+
+	return n;
+}
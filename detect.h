@@ -0,0 +1,33 @@
+/*
+ * Description: detect.h, header file for detect.c
+ */
+
+#include <glib.h>
+
+#define LANGUAGES_DIR	"languages"
+#define SAMPLES_DIR	"samples"
+
+/* weights of the statistics in the distance between a text and a model */
+#define IOC_WEIGHT	10.0
+#define PATTERN_WEIGHT	0.5
+
+/* structs */
+typedef struct {
+	char path[N];
+	int model;
+	double freq[KEYSIZE];
+	double ioc;
+	int rank[KEYSIZE];
+	int alphabet;
+	GHashTable *patterns;
+	long words;
+	double distance;
+} Profile;
+
+/* function declarations */
+void profile_text(FILE *f, Profile *p);
+void profile_lang(FILE *f, Profile *p);
+void free_profile(Profile *p);
+double text_distance(Profile *c, Profile *m);
+double lang_distance(Profile *c, Profile *m, Profile *l);
+int detect_language(FILE *fi, int nthreads, char *lang, char *sample);
@@ -0,0 +1,251 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: pattern.c, word pattern (isomorph) index built from the
+ * 		sample file and a constraint solver that assigns dictionary
+ * 		words to ciphertext words with the same letter pattern.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "pattern.h"
+#include "counts.h"
+
+/* function implementations */
+void
+word_pattern(const char *w, char *p) {
+	char seen[N] = {'\0'};
+	char next = 'A';
+	int i;
+
+	/* "sweep" -> "ABCCD" */
+	for(i=0; w[i] != '\0'; i++) {
+		if(!seen[(unsigned char)w[i]])
+			seen[(unsigned char)w[i]] = next++;
+		p[i] = seen[(unsigned char)w[i]];
+	}
+	p[i] = '\0';
+}
+
+static int
+is_lower_word(const char *w) {
+	int i;
+
+	for(i=0; w[i] != '\0'; i++)
+		if(w[i] < 'a' || w[i] > 'z')
+			return 0;
+
+	return i > 0;
+}
+
+static void
+free_cand(gpointer p) {
+	g_ptr_array_free(p, TRUE);
+}
+
+PatternIndex *
+pattern_index_new(FILE *fs) {
+	PatternIndex *idx;
+	GPtrArray *cand;
+	GList *iter;
+	char p[N];
+
+	idx = malloc(sizeof(PatternIndex));
+	idx->table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_cand);
+	idx->words = sample_words(fs);
+	/* the word list is sorted by occurrences, so are the candidates */
+	for(iter = g_list_first(idx->words); iter != NULL; iter = iter->next) {
+		if(!is_lower_word(((Word *)iter->data)->word))
+			continue;
+		word_pattern(((Word *)iter->data)->word, p);
+		cand = g_hash_table_lookup(idx->table, p);
+		if(cand == NULL) {
+			cand = g_ptr_array_new();
+			g_hash_table_insert(idx->table, g_strdup(p), cand);
+		}
+		if(cand->len < PATTERN_CANDS)
+			g_ptr_array_add(cand, iter->data);
+	}
+
+	return idx;
+}
+
+void
+pattern_index_free(PatternIndex *idx) {
+	g_hash_table_destroy(idx->table);
+	free_list(idx->words);
+	free(idx);
+}
+
+/* extend the mapping with cipher word c -> plain word p, -1 on conflict */
+static int
+assign(PatternSolver *s, const char *c, const char *p, char *undo) {
+	int i, n = 0, x, y;
+
+	for(i=0; c[i] != '\0'; i++) {
+		x = c[i]-OFFSET;
+		y = p[i]-OFFSET;
+		if(s->map[x] == 0 && s->inv[y] == 0) {
+			s->map[x] = p[i];
+			s->inv[y] = c[i];
+			undo[n++] = x;
+		}
+		else if(s->map[x] != p[i]) {
+			/* roll back the letters set so far */
+			while(n > 0) {
+				x = undo[--n];
+				s->inv[s->map[x]-OFFSET] = 0;
+				s->map[x] = 0;
+			}
+			return -1;
+		}
+	}
+
+	return n;
+}
+
+static void
+unassign(PatternSolver *s, char *undo, int n) {
+	int x;
+
+	while(n > 0) {
+		x = undo[--n];
+		s->inv[s->map[x]-OFFSET] = 0;
+		s->map[x] = 0;
+	}
+}
+
+static int
+consistent(PatternSolver *s, const char *c, const char *p) {
+	int i;
+
+	for(i=0; c[i] != '\0'; i++)
+		if(s->map[c[i]-OFFSET] != 0) {
+			if(s->map[c[i]-OFFSET] != p[i])
+				return 0;
+		}
+		else if(s->inv[p[i]-OFFSET] != 0)
+			return 0;
+
+	return 1;
+}
+
+static void
+search(PatternSolver *s) {
+	char undo[KEYSIZE];
+	Isomorph *w;
+	guint j;
+	int i, n, count, min = 0, next = -1, potential = 0;
+
+	if(++s->nodes > PATTERN_NODES)
+		return;
+	/*
+	 * forward checking: words left without a consistent candidate can not
+	 * score anymore, the most constrained of the others is branched on next
+	 */
+	for(i=0; i<s->n; i++) {
+		w = &s->iso[i];
+		if(w->done)
+			continue;
+		for(count=0, j=0; j<w->cand->len && count<PATTERN_MRV; j++)
+			count += consistent(s, w->word, ((Word *)g_ptr_array_index(w->cand, j))->word);
+		if(count == 0)
+			continue;
+		potential += w->weight;
+		if(next < 0 || count < min || (count == min && w->weight > s->iso[next].weight)) {
+			min = count;
+			next = i;
+		}
+	}
+	if(s->score > s->best_score) {
+		s->best_score = s->score;
+		memcpy(s->best, s->map, KEYSIZE);
+	}
+	/* bound: even matching every remaining word can not beat the best */
+	if(next < 0 || s->score + potential <= s->best_score)
+		return;
+	w = &s->iso[next];
+	w->done = 1;
+	for(j=0; j<w->cand->len; j++) {
+		n = assign(s, w->word, ((Word *)g_ptr_array_index(w->cand, j))->word, undo);
+		if(n < 0)
+			continue;
+		s->score += w->weight;
+		search(s);
+		s->score -= w->weight;
+		unassign(s, undo, n);
+	}
+	/* the word may simply be missing from the sample */
+	search(s);
+	w->done = 0;
+}
+
+int
+solve_patterns(PatternIndex *idx, FILE *fi, char map[KEYSIZE]) {
+	PatternSolver s;
+	GList *cipher, *iter;
+	GPtrArray *cand;
+	Word *w;
+	char p[N];
+	int i;
+
+	cipher = count_words(fi, NULL, 0);
+	s.iso = malloc(g_list_length(g_list_first(cipher)) * sizeof(Isomorph));
+	s.n = 0;
+	for(iter = g_list_first(cipher); iter != NULL; iter = iter->next) {
+		w = iter->data;
+		if(!is_lower_word(w->word))
+			continue;
+		word_pattern(w->word, p);
+		if((cand = g_hash_table_lookup(idx->table, p)) == NULL)
+			continue;
+		s.iso[s.n].word = w->word;
+		s.iso[s.n].len = strlen(w->word);
+		s.iso[s.n].weight = s.iso[s.n].len * w->occ;
+		s.iso[s.n].cand = cand;
+		s.iso[s.n].done = 0;
+		s.n++;
+	}
+	/* letters already known in map are kept */
+	memcpy(s.map, map, KEYSIZE);
+	memset(s.inv, 0, KEYSIZE);
+	for(i=0; i<KEYSIZE; i++)
+		if(s.map[i] != 0)
+			s.inv[s.map[i]-OFFSET] = i+OFFSET;
+	memcpy(s.best, s.map, KEYSIZE);
+	s.score = 0;
+	s.best_score = 0;
+	s.nodes = 0;
+
+	search(&s);
+
+	memcpy(map, s.best, KEYSIZE);
+	free(s.iso);
+	free_list(cipher);
+
+	return s.best_score;
+}
+
+void
+pattern_decrypt(FILE *fi, FILE *fs, const char *fixed) {
+	PatternIndex *idx;
+	char map[KEYSIZE];
+	char ks[KEYSIZE];
+	char key[KEYSIZE];
+
+	guess_key(fs, ks);
+	guess_key(fi, key);
+	printf("Decripting using word patterns...\n");
+	idx = pattern_index_new(fs);
+	memcpy(map, fixed, KEYSIZE);
+	solve_patterns(idx, fi, map);
+	pattern_index_free(idx);
+	seed_key(map, ks, key, NULL);
+	seed_key(fixed, ks, key, NULL);
+	print_result(fi, ks, key);
+}
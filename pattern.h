@@ -0,0 +1,44 @@
+/*
+ * Description: pattern.h, header file for pattern.c
+ */
+
+#include <glib.h>
+
+/* search nodes explored before settling for the best assignment so far */
+#define PATTERN_NODES	200000
+/* plaintext candidates kept per pattern, most frequent first */
+#define PATTERN_CANDS	256
+/* consistent candidates counted when picking the most constrained word */
+#define PATTERN_MRV	16
+
+/* structs */
+typedef struct {
+	GHashTable *table;
+	GList *words;
+} PatternIndex;
+
+typedef struct {
+	char *word;
+	int len;
+	int weight;
+	GPtrArray *cand;
+	int done;
+} Isomorph;
+
+typedef struct {
+	Isomorph *iso;
+	int n;
+	char map[KEYSIZE];
+	char inv[KEYSIZE];
+	char best[KEYSIZE];
+	int score;
+	int best_score;
+	long nodes;
+} PatternSolver;
+
+/* function declarations */
+void word_pattern(const char *w, char *p);
+PatternIndex *pattern_index_new(FILE *fs);
+void pattern_index_free(PatternIndex *idx);
+int solve_patterns(PatternIndex *idx, FILE *fi, char map[KEYSIZE]);
+void pattern_decrypt(FILE *fi, FILE *fs, const char *fixed);
@@ -0,0 +1,201 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: progressive.c, decryption of a sample of the ciphertext. A
+ * 		few slices spread over the text are solved first, the sample
+ * 		grows only while too few words decrypt to dictionary words,
+ * 		and a single pass over the whole text verifies the key.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "sweep.h"
+#include "pattern.h"
+#include "counts.h"
+#include "segment.h"
+#include "progressive.h"
+
+/* function implementations */
+static void
+copy_slice(FILE *fi, FILE *fo, long n, int align) {
+	int c, i;
+
+	/* slices start and end between words, if the text has any */
+	for(i=0; align && i<N && (c = fgetc(fi)) != EOF && isalpha(c); i++)
+		;
+	while(n-- > 0 && (c = fgetc(fi)) != EOF)
+		putc(c, fo);
+	for(i=0; i<N && (c = fgetc(fi)) != EOF && isalpha(c); i++)
+		putc(c, fo);
+	putc('\n', fo);
+}
+
+/*
+ * about size bytes of fi in a temporary file, or fi itself when it is not
+ * longer than that; total gets the length of fi, -1 if it cannot be told
+ */
+FILE *
+take_sample(FILE *fi, long size, long *total) {
+	FILE *fo;
+	int i;
+
+	*total = fseek(fi, 0, SEEK_END) == 0 ? ftell(fi) : -1;
+	rewind(fi);
+	if(*total >= 0 && *total <= size)
+		return fi;
+	if((fo = tmpfile()) == NULL)
+		return fi;
+	/* streams only rewind, they give a prefix instead of slices */
+	if(*total < 0)
+		copy_slice(fi, fo, size, 0);
+	else
+		for(i=0; i<PROGRESSIVE_STRATA; i++) {
+			fseek(fi, *total / PROGRESSIVE_STRATA * i, SEEK_SET);
+			copy_slice(fi, fo, size / PROGRESSIVE_STRATA, i > 0);
+		}
+	rewind(fo);
+
+	return fo;
+}
+
+/* share of the words of f, decrypted with key, found in dict; one pass */
+double
+dictionary_rate(FILE *f, const char *ks, const char *key, GHashTable *dict) {
+	char map[N], buf[N];
+	long words = 0, hits = 0;
+	int c, i, n = 0;
+
+	for(i=0; i<N; i++)
+		map[i] = isalpha(i) ? tolower(i) : 0;
+	for(i=0; i<KEYSIZE; i++)
+		map[(unsigned char)ks[i]] = map[toupper(ks[i])] = key[i];
+	rewind(f);
+	do {
+		c = fgetc(f);
+		if(c != EOF && isalpha(c)) {
+			if(n < N-1)
+				buf[n++] = map[c];
+			continue;
+		}
+		if(n > 0) {
+			buf[n] = '\0';
+			hits += g_hash_table_contains(dict, buf);
+			words++;
+		}
+		n = 0;
+	} while(c != EOF);
+
+	return words > 0 ? (double)hits / words : 0;
+}
+
+/*
+ * what dictionary_rate() gives on the sample text, from its word counts;
+ * with letters, the share of letters segment_coverage() would find, words
+ * seen once standing for the words of a text missing from the sample
+ */
+double
+reference_rate(GList *slist, int letters) {
+	GList *iter;
+	double hits = 0, words = 0, x;
+	Word *w;
+
+	for(iter = g_list_first(slist); iter != NULL; iter = iter->next) {
+		w = iter->data;
+		x = letters ? (double)w->occ * strlen(w->word) : w->occ;
+		words += x;
+		hits += w->occ > 1 ? x : 0;
+	}
+
+	return words > 0 ? hits / words : 0;
+}
+
+void
+progressive_decrypt(FILE *fi, FILE *fs, Search *search) {
+	FILE *sample;
+	Model *model;
+	Budget budget;
+	PatternIndex *idx;
+	Segmenter *seg = NULL;
+	GHashTable *dict;
+	GList *slist;
+	char *ks;
+	char key[KEYSIZE];
+	char last[KEYSIZE];
+	char map[KEYSIZE];
+	double v, rate, expected;
+	long size, total, len;
+	int round, whole;
+
+	/* the limits bound the whole run, loading the sample too */
+	budget_begin(&budget, search->time_limit, search->max_evals);
+	model = model_new(fs);
+	ks = model->ks;
+	slist = sample_words(fs);
+	dict = dictionary_new(slist);
+	for(round = 0, size = search->progressive; ; round++, size *= PROGRESSIVE_GROWTH) {
+		sample = take_sample(fi, size, &total);
+		len = fseek(sample, 0, SEEK_END) == 0 ? ftell(sample) : size;
+		rewind(sample);
+		if(round == 0) {
+			guess_key(sample, key);
+			if(search->patterns) {
+				printf("Seeding the key with word patterns...\n");
+				idx = pattern_index_new(fs);
+				memcpy(map, search->fixed, KEYSIZE);
+				solve_patterns(idx, sample, map);
+				pattern_index_free(idx);
+				seed_key(map, ks, key, NULL);
+			}
+			if(search->segment || needs_segmentation(sample))
+				seg = segmenter_new(slist);
+			/* compared with the rate measured below, on the same terms */
+			expected = reference_rate(slist, seg != NULL);
+		}
+		/* every round refines the key of the previous one */
+		printf("Solving a sample of %ld bytes...\n", len);
+		memcpy(last, key, KEYSIZE);
+		v = climb_ngrams(sample, model, key, search, &budget, 1);
+		if(!budget_exhausted(&budget) && seg != NULL)
+			climb_segments(sample, ks, seg, key, search, &budget, 1);
+		else if(!budget_exhausted(&budget))
+			climb_words(sample, ks, slist, key, search, &budget, 1);
+		rate = seg != NULL ? segment_coverage(seg, sample, ks, key) : dictionary_rate(sample, ks, key, dict);
+		printf("\rn-gram score %f, %.1f%% of the sample in dictionary words, %.1f%% expected\n", v, 100 * rate, 100 * expected);
+		/* the whole input was the sample, there is nothing left to grow */
+		whole = sample == fi;
+		if(!whole)
+			fclose(sample);
+		if(budget.stopped) {
+			printf("stopped, %s after %ld evaluations\n", budget_reason(&budget), budget.evals);
+			break;
+		}
+		/* trusted, or a sample four times as long did not change it */
+		if(whole || rate >= PROGRESSIVE_CONFIDENCE * expected)
+			break;
+		if(round > 0 && memcmp(last, key, KEYSIZE) == 0)
+			break;
+		/* a stream of unknown length is as long as the biggest prefix read */
+		if(total < 0 && len < size)
+			break;
+	}
+	budget_end(&budget);
+
+	printf("Verifying the key on the whole text...\n");
+	rate = seg != NULL ? segment_coverage(seg, fi, ks, key) : dictionary_rate(fi, ks, key, dict);
+	printf("%.1f%% of the text in dictionary words\n", 100 * rate);
+	print_result(fi, ks, key);
+	if(seg != NULL) {
+		print_segmentation(seg, fi, ks, key);
+		segmenter_free(seg);
+	}
+	g_hash_table_destroy(dict);
+	free_list(slist);
+	model_free(model);
+	state_pool_clear();
+}
@@ -0,0 +1,21 @@
+/*
+ * Description: progressive.h, header file for progressive.c
+ */
+
+#include <glib.h>
+
+/* the sample is cut in this many slices spread over the text */
+#define PROGRESSIVE_STRATA	8
+/* growth of the sample while the key is not trusted */
+#define PROGRESSIVE_GROWTH	4
+/*
+ * share of dictionary words, or of segmented letters, to trust a key, as a
+ * fraction of the share in the sample text itself
+ */
+#define PROGRESSIVE_CONFIDENCE	0.8
+
+/* function declarations */
+FILE *take_sample(FILE *fi, long size, long *total);
+double dictionary_rate(FILE *f, const char *ks, const char *key, GHashTable *dict);
+double reference_rate(GList *slist, int letters);
+void progressive_decrypt(FILE *fi, FILE *fs, Search *search);
@@ -0,0 +1,173 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: remap.c, translation of the input into the -o file. Every
+ * 		byte is remapped on its own, so chunks of a regular input
+ * 		file are read and translated by many threads straight into
+ * 		a memory mapped output file.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "remap.h"
+
+/* function implementations */
+static void
+translate(char *buf, size_t n, const char *table) {
+	size_t i;
+
+	for(i=0; i<n; i++)
+		buf[i] = table[(unsigned char)buf[i]];
+}
+
+static int
+read_full(int fd, char *buf, size_t n, off_t off) {
+	ssize_t r;
+
+	while(n > 0) {
+		if((r = pread(fd, buf, n, off)) < 0 && errno == EINTR)
+			continue;
+		if(r <= 0)
+			return -1;
+		buf += r;
+		off += r;
+		n -= r;
+	}
+
+	return 0;
+}
+
+static int
+write_full(int fd, const char *buf, size_t n, off_t off) {
+	ssize_t r;
+
+	while(n > 0) {
+		if((r = pwrite(fd, buf, n, off)) < 0 && errno == EINTR)
+			continue;
+		if(r <= 0)
+			return -1;
+		buf += r;
+		off += r;
+		n -= r;
+	}
+
+	return 0;
+}
+
+static gpointer
+remap_chunks(gpointer data) {
+	Remap *r = data;
+	char *dst;
+	off_t off;
+	size_t n;
+	gint i;
+
+	/* threads take the next chunk until none is left */
+	while((i = g_atomic_int_add(r->next, 1)) < r->nchunks) {
+		off = (off_t)i * REMAP_CHUNK;
+		n = r->size - off < REMAP_CHUNK ? r->size - off : REMAP_CHUNK;
+		/* mapped, the chunk is read in place and never copied */
+		dst = r->map != NULL ? r->map + off : r->buf;
+		if(read_full(r->in, dst, n, off) < 0) {
+			r->failed = 1;
+			continue;
+		}
+		translate(dst, n, r->table);
+		if(r->map == NULL && write_full(r->out, dst, n, off) < 0)
+			r->failed = 1;
+	}
+
+	return NULL;
+}
+
+/* streams without a file behind, like compressed input, in one thread */
+static int
+remap_stream(FILE *fi, const char *path, const char *table) {
+	FILE *fo;
+	char *buf;
+	size_t n;
+	int ret = 0;
+
+	if((fo = fopen(path, "w")) == NULL)
+		return -1;
+	buf = malloc(REMAP_CHUNK);
+	while((n = fread(buf, 1, REMAP_CHUNK, fi)) > 0) {
+		translate(buf, n, table);
+		if(fwrite(buf, 1, n, fo) != n)
+			ret = -1;
+	}
+	free(buf);
+	if(ferror(fi) || fclose(fo) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+int
+remap_file(FILE *fi, const char *path, const char *table, int nthreads) {
+	GThread **threads;
+	Remap *r;
+	struct stat st;
+	void *map;
+	gint next = 0;
+	int i, n, in, out, ret = 0;
+
+	rewind(fi);
+	in = fileno(fi);
+	if(in < 0 || fstat(in, &st) < 0 || !S_ISREG(st.st_mode))
+		return remap_stream(fi, path, table);
+	if((out = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666)) < 0)
+		return -1;
+	map = MAP_FAILED;
+	if(st.st_size > 0) {
+		/* reserved blocks, a full disk fails here and not with SIGBUS */
+		if((errno = posix_fallocate(out, 0, st.st_size)) == 0)
+			map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+		else if(errno == ENOSPC || errno == EFBIG || ftruncate(out, st.st_size) < 0) {
+			close(out);
+			return -1;
+		}
+	}
+	n = nthreads < 1 ? 1 : nthreads;
+	r = malloc(n * sizeof(Remap));
+	threads = malloc(n * sizeof(GThread *));
+	for(i=0; i<n; i++) {
+		r[i].in = in;
+		r[i].out = out;
+		r[i].map = map != MAP_FAILED ? map : NULL;
+		r[i].buf = r[i].map == NULL ? malloc(REMAP_CHUNK) : NULL;
+		r[i].table = table;
+		r[i].size = st.st_size;
+		r[i].nchunks = (st.st_size + REMAP_CHUNK - 1) / REMAP_CHUNK;
+		r[i].next = &next;
+		r[i].failed = 0;
+		if(i > 0)
+			threads[i] = g_thread_new("remap", remap_chunks, &r[i]);
+	}
+	remap_chunks(&r[0]);
+	for(i=1; i<n; i++)
+		g_thread_join(threads[i]);
+	for(i=0; i<n; i++) {
+		ret |= r[i].failed ? -1 : 0;
+		free(r[i].buf);
+	}
+	if(map != MAP_FAILED && munmap(map, st.st_size) < 0)
+		ret = -1;
+	if(close(out) < 0)
+		ret = -1;
+	free(threads);
+	free(r);
+
+	return ret;
+}
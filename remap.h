@@ -0,0 +1,25 @@
+/*
+ * Description: remap.h, header file for remap.c
+ */
+
+#include <glib.h>
+
+/* bytes translated by a thread at a time */
+#define REMAP_CHUNK	(1 << 22)
+
+/* structs */
+typedef struct {
+	int in;
+	int out;
+	/* the mapped output file, NULL to pwrite() every chunk */
+	char *map;
+	char *buf;
+	const char *table;
+	long size;
+	gint nchunks;
+	gint *next;
+	int failed;
+} Remap;
+
+/* function declarations */
+int remap_file(FILE *fi, const char *path, const char *table, int nthreads);
@@ -0,0 +1,339 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: segment.c, word segmentation of text without blanks. A
+ * 		Viterbi pass over a trie of the sample vocabulary finds the
+ * 		most likely split into words, its log probability scores
+ * 		keys when the ciphertext hides word boundaries.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "sweep.h"
+#include "cache.h"
+#include "segment.h"
+
+/* function implementations */
+static gint32
+trie_node(Segmenter *s) {
+	int i;
+
+	if(s->n == s->size) {
+		s->size *= 2;
+		s->node = realloc(s->node, s->size * sizeof(TrieNode));
+	}
+	for(i=0; i<KEYSIZE; i++)
+		s->node[s->n].next[i] = 0;
+	s->node[s->n].logp = SEGMENT_NONE;
+
+	return s->n++;
+}
+
+Segmenter *
+segmenter_new(GList *words) {
+	Segmenter *s;
+	GList *iter;
+	Word *w;
+	double total = 0;
+	gint32 x, y;
+	int i, c;
+
+	s = malloc(sizeof(Segmenter));
+	s->size = 1024;
+	s->n = 0;
+	s->depth = 0;
+	s->node = malloc(s->size * sizeof(TrieNode));
+	trie_node(s);
+	for(iter = g_list_first(words); iter != NULL; iter = iter->next)
+		total += ((Word *)iter->data)->occ;
+	for(iter = g_list_first(words); iter != NULL; iter = iter->next) {
+		w = iter->data;
+		for(i=0, x=0; w->word[i] != '\0'; i++) {
+			c = w->word[i];
+			if(c < 'a' || c > 'z')
+				break;
+			if(s->node[x].next[c-OFFSET] == 0) {
+				/* trie_node() may move the array, do not hold a pointer */
+				y = trie_node(s);
+				s->node[x].next[c-OFFSET] = y;
+			}
+			x = s->node[x].next[c-OFFSET];
+		}
+		if(w->word[i] != '\0' || i == 0)
+			continue;
+		s->node[x].logp = log(w->occ / total);
+		s->depth = i > s->depth ? i : s->depth;
+	}
+	/* an unknown letter costs more than any word of the sample */
+	s->unknown = log(1 / (total > 0 ? total : 1)) - log(SEGMENT_UNKNOWN);
+
+	return s;
+}
+
+void
+segmenter_free(Segmenter *s) {
+	free(s->node);
+	free(s);
+}
+
+/*
+ * log probability of the best split of text, best needs len+1 slots;
+ * back, if given, gets the start of the word ending before every position
+ */
+double
+segment(Segmenter *s, const char *text, long len, double *best, long *back) {
+	TrieNode *node = s->node;
+	gint32 x;
+	long i, j;
+	double v;
+
+	best[0] = 0;
+	for(i=1; i<=len; i++)
+		best[i] = -HUGE_VAL;
+	for(i=0; i<len; i++) {
+		/* a letter on its own, whatever it is */
+		if(best[i] + s->unknown > best[i+1]) {
+			best[i+1] = best[i] + s->unknown;
+			if(back != NULL)
+				back[i+1] = i;
+		}
+		/* every word of the vocabulary starting here */
+		for(j=i, x=0; j<len && (x = node[x].next[text[j]-OFFSET]) != 0; j++) {
+			if(node[x].logp == SEGMENT_NONE)
+				continue;
+			v = best[i] + node[x].logp;
+			if(v > best[j+1]) {
+				best[j+1] = v;
+				if(back != NULL)
+					back[j+1] = i;
+			}
+		}
+	}
+
+	return best[len];
+}
+
+/* blanks that split the text in words of the same length are not words */
+int
+needs_segmentation(FILE *fi) {
+	long len[SEGMENT_MAXRUN+1] = {0};
+	long words = 0, letters = 0, run = 0, mode = 0;
+	int c, i;
+
+	rewind(fi);
+	do {
+		c = fgetc(fi);
+		if(c != EOF && isalpha(c)) {
+			run++;
+			letters++;
+			continue;
+		}
+		if(run > 0) {
+			len[run < SEGMENT_MAXRUN ? run : SEGMENT_MAXRUN]++;
+			words++;
+		}
+		run = 0;
+	} while(c != EOF);
+	if(words == 0 || letters / words >= SEGMENT_MAXRUN)
+		return 1;
+	for(i=1; i<=SEGMENT_MAXRUN; i++)
+		mode = len[i] > mode ? len[i] : mode;
+
+	return words >= 5 && mode >= SEGMENT_GROUPS * words;
+}
+
+/* the lowercase letters of the input, nothing else */
+long
+read_letters(FILE *fi, char **letters) {
+	long n = 0, size = 1024;
+	int c;
+
+	*letters = malloc(size);
+	rewind(fi);
+	while((c = fgetc(fi)) != EOF) {
+		if(!isalpha(c))
+			continue;
+		if(n == size) {
+			size *= 2;
+			*letters = realloc(*letters, size);
+		}
+		(*letters)[n++] = tolower(c);
+	}
+
+	return n;
+}
+
+double
+segment_score(void *ctx, int a, int b, double bound) {
+	Segment *g = ctx;
+	char dec[KEYSIZE];
+	long i;
+	int j;
+
+	(void)bound;
+	/* decrypt_to_file() turns ks[j] into key[j], here with a and b swapped */
+	for(j=0; j<KEYSIZE; j++)
+		dec[g->ks[j]-OFFSET] = g->key[j == a ? b : j == b ? a : j];
+	for(i=0; i<g->len; i++)
+		g->plain[i] = dec[g->cipher[i]-OFFSET];
+
+	/* most likely is best, the sweep wants lower */
+	return -segment(g->seg, g->plain, g->len, g->best, NULL);
+}
+
+/* hill climb on the log probability of the best segmentation */
+double
+climb_segments(FILE *fi, char *ks, Segmenter *seg, char *key, Search *search, Budget *budget, int verbose) {
+	Segment **g;
+	Sweep *sw;
+	Cache *cache;
+	Swap cand[KEYSIZE*(KEYSIZE-1)/2];
+	char locked[KEYSIZE];
+	char *cipher;
+	char loader[] = "|/-\\|";
+	double v, v1;
+	long len;
+	int a, i = 0, j, n, ncand;
+
+	seed_key(search->fixed, ks, key, locked);
+	len = read_letters(fi, &cipher);
+	/* every score is a decryption in memory, threads can share the work */
+	n = search->threads < 1 ? 1 : search->threads;
+	g = malloc(n * sizeof(Segment *));
+	for(j=0; j<n; j++) {
+		g[j] = malloc(sizeof(Segment));
+		g[j]->seg = seg;
+		g[j]->cipher = cipher;
+		g[j]->len = len;
+		g[j]->ks = ks;
+		memcpy(g[j]->key, key, KEYSIZE);
+		g[j]->plain = malloc(len + 1);
+		g[j]->best = malloc((len + 1) * sizeof(double));
+	}
+	sw = sweep_new(n, segment_score, (void **)g);
+	cache = cache_new(KEYSIZE, CACHE_BITS);
+	sweep_cache(sw, cache, key);
+	sweep_budget(sw, budget);
+	ncand = drop_locked(cand, neighbourhood(cand, KEYSIZE), locked);
+
+	v = segment_score(g[0], 0, 0, HUGE_VAL);
+	budget->evals++;
+	while((j = sweep_run(sw, cand, ncand, search->policy, v, &v1)) >= 0) {
+		if(verbose)
+			printf("\r%c", loader[i++ % 5]);
+		v = v1;
+		for(a=0; a<n; a++)
+			swap_in_key(g[a]->key, cand[j].a, cand[j].b);
+		swap_in_key(key, cand[j].a, cand[j].b);
+	}
+	sweep_free(sw);
+	cache_free(cache);
+	for(j=0; j<n; j++) {
+		free(g[j]->plain);
+		free(g[j]->best);
+		free(g[j]);
+	}
+	free(g);
+	free(cipher);
+
+	return -v;
+}
+
+/*
+ * the words of a block of plain letters, last is the length of the word
+ * printed before the block, the length of the last word is returned
+ */
+static long
+print_segmented(Segmenter *s, const char *plain, long len, double *best, long *back, long *start, long last) {
+	long i, k, n = 0;
+
+	segment(s, plain, len, best, back);
+	/* the words were found backwards */
+	for(i=len; i>0; i=back[i])
+		start[n++] = back[i];
+	for(k=n-1; k>=0; k--)
+		start[k] = (k > 0 ? start[k-1] : len) - start[k];
+	for(i=0, k=n-1; k>=0; k--) {
+		/* runs of single letters are mostly words missing from the sample */
+		if(last > 0 && (last > 1 || start[k] > 1))
+			putchar(' ');
+		fwrite(plain + i, 1, start[k], stdout);
+		i += start[k];
+		last = start[k];
+	}
+
+	return last;
+}
+
+/* the best split of fi decrypted with key, a block at a time like segment_coverage() */
+void
+print_segmentation(Segmenter *s, FILE *fi, const char *ks, const char *key) {
+	char map[KEYSIZE], *text;
+	double *best;
+	long *back, *start, i, n, last = 0;
+	int c;
+
+	for(i=0; i<KEYSIZE; i++)
+		map[ks[i]-OFFSET] = key[i];
+	text = malloc(SEGMENT_BLOCK);
+	best = malloc((SEGMENT_BLOCK + 1) * sizeof(double));
+	back = malloc((SEGMENT_BLOCK + 1) * sizeof(long));
+	start = malloc((SEGMENT_BLOCK + 1) * sizeof(long));
+	printf("Segmented result:\n\n");
+	rewind(fi);
+	do {
+		for(n=0; n < SEGMENT_BLOCK && (c = fgetc(fi)) != EOF; )
+			if(isalpha(c))
+				text[n++] = map[tolower(c)-OFFSET];
+		last = print_segmented(s, text, n, best, back, start, last);
+	} while(n == SEGMENT_BLOCK);
+	putchar('\n');
+	putchar('\n');
+	free(text);
+	free(best);
+	free(back);
+	free(start);
+}
+
+/* share of the letters of fi, decrypted with key, split into sample words */
+double
+segment_coverage(Segmenter *s, FILE *fi, const char *ks, const char *key) {
+	char map[KEYSIZE], *text;
+	double *best;
+	long *back, i, j, n, known = 0, total = 0;
+	gint32 x;
+	int c;
+
+	for(i=0; i<KEYSIZE; i++)
+		map[ks[i]-OFFSET] = key[i];
+	text = malloc(SEGMENT_BLOCK);
+	best = malloc((SEGMENT_BLOCK + 1) * sizeof(double));
+	back = malloc((SEGMENT_BLOCK + 1) * sizeof(long));
+	rewind(fi);
+	do {
+		/* blocks are split on their own, only the edges may cut a word */
+		for(n=0; n < SEGMENT_BLOCK && (c = fgetc(fi)) != EOF; )
+			if(isalpha(c))
+				text[n++] = map[tolower(c)-OFFSET];
+		segment(s, text, n, best, back);
+		for(i=n; i>0; i=back[i]) {
+			for(j=back[i], x=0; j<i && (x = s->node[x].next[text[j]-OFFSET]) != 0; j++)
+				;
+			if(j == i && s->node[x].logp != SEGMENT_NONE)
+				known += i - back[i];
+		}
+		total += n;
+	} while(n == SEGMENT_BLOCK);
+	free(text);
+	free(best);
+	free(back);
+
+	return total > 0 ? (double)known / total : 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Description: segment.h, header file for segment.c
+ */
+
+#include <glib.h>
+
+/* no word ends in this trie node */
+#define SEGMENT_NONE	1.0f
+/* extra cost, as a factor, of every letter outside the vocabulary */
+#define SEGMENT_UNKNOWN	10.0
+/* words are delimited only if most of them do not share one length */
+#define SEGMENT_GROUPS	0.8
+#define SEGMENT_MAXRUN	15
+/* letters split at a time when measuring the coverage of a text */
+#define SEGMENT_BLOCK	(1 << 16)
+
+/* structs */
+typedef struct {
+	gint32 next[KEYSIZE];
+	float logp;
+} TrieNode;
+
+/* unigram log probabilities of the sample words, in a trie */
+typedef struct {
+	TrieNode *node;
+	int n;
+	int size;
+	int depth;
+	double unknown;
+} Segmenter;
+
+/* scoring context of a thread, cipher letters are shared */
+typedef struct {
+	Segmenter *seg;
+	const char *cipher;
+	long len;
+	const char *ks;
+	char key[KEYSIZE];
+	char *plain;
+	double *best;
+} Segment;
+
+/* function declarations */
+Segmenter *segmenter_new(GList *words);
+void segmenter_free(Segmenter *s);
+double segment(Segmenter *s, const char *text, long len, double *best, long *back);
+int needs_segmentation(FILE *fi);
+long read_letters(FILE *fi, char **letters);
+double segment_score(void *ctx, int a, int b, double bound);
+double climb_segments(FILE *fi, char *ks, Segmenter *seg, char *key, Search *search, Budget *budget, int verbose);
+void print_segmentation(Segmenter *s, FILE *fi, const char *ks, const char *key);
+double segment_coverage(Segmenter *s, FILE *fi, const char *ks, const char *key);
@@ -0,0 +1,303 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: source.c, transparent gzip and zstd input. A decompression
+ * 		thread fills fixed size blocks and hands them to the reader
+ * 		through a bounded queue, behind an ordinary FILE stream.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "utils.h"
+#include "source.h"
+
+/* function implementations */
+int
+source_type(const char *path) {
+	unsigned char m[4] = {0};
+	FILE *f;
+	size_t n;
+
+	if((f = fopen(path, "rb")) == NULL)
+		return -1;
+	n = fread(m, 1, 4, f);
+	fclose(f);
+	if(n >= 2 && m[0] == 0x1f && m[1] == 0x8b)
+		return SOURCE_GZIP;
+	if(n == 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd)
+		return SOURCE_ZSTD;
+
+	return SOURCE_PLAIN;
+}
+
+static Block *
+next_empty(Stream *s) {
+	Block *b;
+
+	/* blocks only for as long as the reader is QUEUE_BLOCKS behind */
+	b = g_async_queue_pop(s->empty);
+	b->len = 0;
+
+	return b;
+}
+
+/* hand a block over, returns 0 when the reader asked to stop */
+static int
+push_full(Stream *s, Block *b) {
+	g_async_queue_push(s->full, b);
+
+	return !g_atomic_int_get(&s->stop);
+}
+
+#ifdef HAVE_ZLIB
+static void
+inflate_gzip(Stream *s) {
+	gzFile gz;
+	Block *b;
+	int n, err;
+
+	if((gz = gzopen(s->path, "rb")) == NULL) {
+		s->error = 1;
+		return;
+	}
+	gzbuffer(gz, BLOCK_SIZE);
+	do {
+		b = next_empty(s);
+		if((n = gzread(gz, b->data, BLOCK_SIZE)) <= 0) {
+			/* a truncated stream ends with Z_BUF_ERROR, not -1 */
+			gzerror(gz, &err);
+			s->error = n < 0 || err != Z_OK;
+			g_async_queue_push(s->empty, b);
+			break;
+		}
+		b->len = n;
+	} while(push_full(s, b));
+	gzclose(gz);
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static void
+inflate_zstd(Stream *s) {
+	ZSTD_DStream *z;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	char *buf;
+	size_t size, r = 0;
+	FILE *f;
+	Block *b;
+	int go = 1, full = 0;
+
+	if((f = fopen(s->path, "rb")) == NULL) {
+		s->error = 1;
+		return;
+	}
+	z = ZSTD_createDStream();
+	ZSTD_initDStream(z);
+	size = ZSTD_DStreamInSize();
+	buf = malloc(size);
+	in.src = buf;
+	in.size = 0;
+	in.pos = 0;
+	b = next_empty(s);
+	while(go) {
+		/* a full block may leave output buffered in the decoder */
+		if(in.pos == in.size && !full) {
+			/* the input ends inside a frame when r is not 0 */
+			if((in.size = fread(buf, 1, size, f)) == 0) {
+				s->error = r != 0 || ferror(f);
+				break;
+			}
+			in.pos = 0;
+		}
+		out.dst = b->data;
+		out.size = BLOCK_SIZE;
+		out.pos = b->len;
+		r = ZSTD_decompressStream(z, &out, &in);
+		if(ZSTD_isError(r)) {
+			s->error = 1;
+			break;
+		}
+		b->len = out.pos;
+		full = b->len == BLOCK_SIZE;
+		if(full) {
+			go = push_full(s, b);
+			b = next_empty(s);
+		}
+	}
+	if(b->len > 0 && go)
+		push_full(s, b);
+	else
+		g_async_queue_push(s->empty, b);
+	free(buf);
+	ZSTD_freeDStream(z);
+	fclose(f);
+}
+#endif
+
+static gpointer
+producer(gpointer data) {
+	Stream *s = data;
+	Block *b;
+
+	switch(s->type) {
+#ifdef HAVE_ZLIB
+		case SOURCE_GZIP:
+			inflate_gzip(s);
+			break;
+#endif
+#ifdef HAVE_ZSTD
+		case SOURCE_ZSTD:
+			inflate_zstd(s);
+			break;
+#endif
+		default:
+			break;
+	}
+	/* an empty block marks the end of the stream */
+	b = next_empty(s);
+	g_async_queue_push(s->full, b);
+
+	return NULL;
+}
+
+static void
+start(Stream *s) {
+	s->stop = 0;
+	s->done = 0;
+	s->error = 0;
+	s->cur = NULL;
+	s->pos = 0;
+	s->offset = 0;
+	s->thread = g_thread_new("inflate", producer, s);
+}
+
+static void
+finish(Stream *s) {
+	Block *b;
+
+	/* give every block back until the producer has seen the stop */
+	g_atomic_int_set(&s->stop, 1);
+	if(s->cur != NULL) {
+		g_async_queue_push(s->empty, s->cur);
+		s->cur = NULL;
+	}
+	while(!s->done) {
+		b = g_async_queue_pop(s->full);
+		if(b->len == 0)
+			s->done = 1;
+		g_async_queue_push(s->empty, b);
+	}
+	g_thread_join(s->thread);
+}
+
+static ssize_t
+stream_read(void *cookie, char *buf, size_t size) {
+	Stream *s = cookie;
+	size_t n = 0, k;
+
+	/* the end block comes after the producer has set error */
+	if(s->done && s->error)
+		return -1;
+	while(n < size && !s->done) {
+		if(s->cur == NULL) {
+			s->cur = g_async_queue_pop(s->full);
+			s->pos = 0;
+			if(s->cur->len == 0) {
+				g_async_queue_push(s->empty, s->cur);
+				s->cur = NULL;
+				s->done = 1;
+				break;
+			}
+		}
+		k = s->cur->len - s->pos;
+		if(k > size - n)
+			k = size - n;
+		memcpy(buf + n, s->cur->data + s->pos, k);
+		n += k;
+		s->pos += k;
+		if(s->pos == s->cur->len) {
+			g_async_queue_push(s->empty, s->cur);
+			s->cur = NULL;
+		}
+	}
+	s->offset += n;
+	if(n == 0 && s->error)
+		return -1;
+
+	return n;
+}
+
+static int
+stream_seek(void *cookie, off64_t *offset, int whence) {
+	Stream *s = cookie;
+
+	if(whence == SEEK_CUR && *offset == 0) {
+		*offset = s->offset;
+		return 0;
+	}
+	if(whence != SEEK_SET || *offset != 0)
+		return -1;
+	/* rewinding starts the decompression over, nothing is spooled */
+	finish(s);
+	start(s);
+
+	return 0;
+}
+
+static int
+stream_close(void *cookie) {
+	Stream *s = cookie;
+	Block *b;
+
+	finish(s);
+	while((b = g_async_queue_try_pop(s->empty)) != NULL)
+		free(b);
+	g_async_queue_unref(s->full);
+	g_async_queue_unref(s->empty);
+	g_free(s->path);
+	free(s);
+
+	return 0;
+}
+
+FILE *
+open_input(const char *path) {
+	cookie_io_functions_t io = {stream_read, NULL, stream_seek, stream_close};
+	Stream *s;
+	int i, type;
+
+	type = source_type(path);
+	if(type < 0)
+		return NULL;
+	if(type == SOURCE_PLAIN)
+		return fopen(path, "r");
+#ifndef HAVE_ZLIB
+	if(type == SOURCE_GZIP)
+		die("Gzip input is not supported in this build.");
+#endif
+#ifndef HAVE_ZSTD
+	if(type == SOURCE_ZSTD)
+		die("Zstd input is not supported in this build.");
+#endif
+	s = malloc(sizeof(Stream));
+	s->path = g_strdup(path);
+	s->type = type;
+	s->full = g_async_queue_new();
+	s->empty = g_async_queue_new();
+	for(i=0; i<QUEUE_BLOCKS; i++)
+		g_async_queue_push(s->empty, malloc(sizeof(Block)));
+	start(s);
+
+	return fopencookie(s, "r", io);
+}
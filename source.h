@@ -0,0 +1,39 @@
+/*
+ * Description: source.h, header file for source.c
+ */
+
+#include <glib.h>
+
+/* decompressed blocks, at most QUEUE_BLOCKS are in flight per stream */
+#define BLOCK_SIZE	(1 << 16)
+#define QUEUE_BLOCKS	8
+
+/* input encodings */
+#define SOURCE_PLAIN	0
+#define SOURCE_GZIP	1
+#define SOURCE_ZSTD	2
+
+/* structs */
+typedef struct {
+	char data[BLOCK_SIZE];
+	size_t len;
+} Block;
+
+typedef struct {
+	char *path;
+	int type;
+	GThread *thread;
+	GAsyncQueue *full;
+	GAsyncQueue *empty;
+	Block *cur;
+	size_t pos;
+	long offset;
+	int done;
+	int stop;
+	/* set by the producer when the input cannot be read to its end */
+	int error;
+} Stream;
+
+/* function declarations */
+int source_type(const char *path);
+FILE *open_input(const char *path);
@@ -0,0 +1,316 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: sweep.c, parallel evaluation of the swap neighbourhood of a
+ * 		key. Every candidate is scored against the same key, so the
+ * 		accepted swap does not depend on the number of threads.
+ */
+
+#include <stdlib.h>
+#include "sweep.h"
+#include "cache.h"
+
+typedef struct {
+	Sweep *s;
+	int id;
+} Worker;
+
+/* set from signal handlers, polled between blocks */
+static volatile sig_atomic_t interrupted = 0;
+
+/* function implementations */
+static void
+interrupt(int sig) {
+	(void)sig;
+	interrupted = 1;
+}
+
+void
+budget_begin(Budget *b, double seconds, long max_evals) {
+	b->deadline = seconds > 0 ? g_get_monotonic_time() + (gint64)(seconds * G_USEC_PER_SEC) : 0;
+	b->max_evals = max_evals > 0 ? max_evals : 0;
+	b->evals = 0;
+	b->stopped = STOP_NONE;
+	/* stop the search, not the program, until budget_end() */
+	interrupted = 0;
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+}
+
+int
+budget_exhausted(Budget *b) {
+	if(b->stopped)
+		return 1;
+	if(interrupted)
+		b->stopped = STOP_SIGNAL;
+	else if(b->max_evals && b->evals >= b->max_evals)
+		b->stopped = STOP_EVALS;
+	else if(b->deadline && g_get_monotonic_time() >= b->deadline)
+		b->stopped = STOP_TIME;
+
+	return b->stopped;
+}
+
+const char *
+budget_reason(Budget *b) {
+	switch(b->stopped) {
+		case STOP_TIME:
+			return "time limit reached";
+		case STOP_EVALS:
+			return "evaluation limit reached";
+		case STOP_SIGNAL:
+			return "interrupted";
+		default:
+			return "done";
+	}
+}
+
+void
+budget_end(Budget *b) {
+	(void)b;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+}
+
+int
+neighbourhood(Swap *cand, int keysize) {
+	int a, b, n = 0;
+
+	/* same order as the original sweep: distance first, then position */
+	for(b=1; b<keysize; b++)
+		for(a=0; a+b<keysize; a++) {
+			cand[n].a = a;
+			cand[n].b = a+b;
+			n++;
+		}
+
+	return n;
+}
+
+/* leave out the swaps touching a locked position */
+int
+drop_locked(Swap *cand, int ncand, const char *locked) {
+	int i, n = 0;
+
+	for(i=0; i<ncand; i++)
+		if(!locked[cand[i].a] && !locked[cand[i].b])
+			cand[n++] = cand[i];
+
+	return n;
+}
+
+static void
+evaluate(Sweep *s, int id) {
+	int i;
+
+	for(i = s->first+id; i < s->last; i += s->n)
+		if(!s->known[i])
+			s->scores[i] = s->score(s->ctx[id], s->cand[i].a, s->cand[i].b, s->bound);
+}
+
+static gpointer
+worker_loop(gpointer data) {
+	Worker *w = data;
+	Sweep *s = w->s;
+	int generation = 0;
+
+	while(1) {
+		g_mutex_lock(&s->lock);
+		while(s->generation == generation && !s->quit)
+			g_cond_wait(&s->start, &s->lock);
+		if(s->quit) {
+			g_mutex_unlock(&s->lock);
+			break;
+		}
+		generation = s->generation;
+		g_mutex_unlock(&s->lock);
+
+		evaluate(s, w->id);
+
+		g_mutex_lock(&s->lock);
+		if(--s->pending == 0)
+			g_cond_signal(&s->done);
+		g_mutex_unlock(&s->lock);
+	}
+	free(w);
+
+	return NULL;
+}
+
+static void
+evaluate_block(Sweep *s, Swap *cand, int first, int last) {
+	s->cand = cand;
+	s->first = first;
+	s->last = last;
+	if(s->n == 1) {
+		evaluate(s, 0);
+		return;
+	}
+	/* wake up the workers, the calling thread acts as worker 0 */
+	g_mutex_lock(&s->lock);
+	s->pending = s->n-1;
+	s->generation++;
+	g_cond_broadcast(&s->start);
+	g_mutex_unlock(&s->lock);
+
+	evaluate(s, 0);
+
+	g_mutex_lock(&s->lock);
+	while(s->pending > 0)
+		g_cond_wait(&s->done, &s->lock);
+	g_mutex_unlock(&s->lock);
+}
+
+Sweep *
+sweep_new(int n, ScoreFunc score, void **ctx) {
+	Sweep *s;
+	Worker *w;
+	int i;
+
+	s = malloc(sizeof(Sweep));
+	s->n = n < 1 ? 1 : n;
+	s->score = score;
+	s->ctx = ctx;
+	s->generation = 0;
+	s->pending = 0;
+	s->quit = 0;
+	s->scores = NULL;
+	s->size = 0;
+	s->cache = NULL;
+	s->key = NULL;
+	s->hashes = NULL;
+	s->known = NULL;
+	s->budget = NULL;
+	g_mutex_init(&s->lock);
+	g_cond_init(&s->start);
+	g_cond_init(&s->done);
+	s->threads = malloc(s->n * sizeof(GThread *));
+	for(i=1; i<s->n; i++) {
+		w = malloc(sizeof(Worker));
+		w->s = s;
+		w->id = i;
+		s->threads[i] = g_thread_new("sweep", worker_loop, w);
+	}
+
+	return s;
+}
+
+void
+sweep_budget(Sweep *s, Budget *b) {
+	s->budget = b;
+}
+
+void
+sweep_cache(Sweep *s, struct Cache *cache, const char *key) {
+	s->cache = cache;
+	s->key = key;
+}
+
+/* fill in the cached scores of a block, only the calling thread does this */
+static void
+lookup_block(Sweep *s, Swap *cand, int first, int last, guint64 hash) {
+	int i;
+
+	for(i = first; i < last; i++) {
+		s->known[i] = 0;
+		if(!s->cache)
+			continue;
+		s->hashes[i] = cache_swap(s->cache, hash, s->key, cand[i].a, cand[i].b);
+		s->known[i] = cache_lookup(s->cache, s->hashes[i], &s->scores[i]);
+	}
+}
+
+static void
+store_block(Sweep *s, int first, int last) {
+	int i;
+
+	if(!s->cache)
+		return;
+	for(i = first; i < last; i++)
+		if(!s->known[i])
+			cache_store(s->cache, s->hashes[i], s->scores[i]);
+}
+
+static void
+count_block(Sweep *s, int first, int last) {
+	int i;
+
+	for(i = first; i < last; i++)
+		if(!s->known[i])
+			s->budget->evals++;
+}
+
+int
+sweep_run(Sweep *s, Swap *cand, int ncand, int policy, double current, double *best) {
+	int i, first, last, block, found = -1;
+	guint64 hash = 0;
+
+	if(ncand > s->size) {
+		s->scores = realloc(s->scores, ncand * sizeof(double));
+		s->hashes = realloc(s->hashes, ncand * sizeof(guint64));
+		s->known = realloc(s->known, ncand);
+		s->size = ncand;
+	}
+	if(s->cache)
+		hash = cache_hash(s->cache, s->key);
+	/*
+	 * first improvement only needs the lowest improving index, which is
+	 * the same whatever the block size is; best improvement needs them all
+	 */
+	block = policy == FIRST_IMPROVEMENT ? s->n * SWEEP_BLOCK : ncand;
+	if(policy == FIRST_IMPROVEMENT && s->n == 1)
+		block = 1;
+	/* a budgeted search checks its limits often, whatever the policy */
+	if(s->budget && block > s->n * SWEEP_BLOCK)
+		block = s->n * SWEEP_BLOCK;
+	*best = current;
+	for(first = 0; first < ncand && (found < 0 || policy != FIRST_IMPROVEMENT); first = last) {
+		if(s->budget && budget_exhausted(s->budget))
+			break;
+		last = first+block < ncand ? first+block : ncand;
+		if(s->budget && s->budget->max_evals && last-first > s->budget->max_evals - s->budget->evals)
+			last = first + (s->budget->max_evals - s->budget->evals);
+		lookup_block(s, cand, first, last, hash);
+		/*
+		 * fixed for the whole block, whatever the threads do; the best
+		 * only goes down, so cut scores stay losers in the cache
+		 */
+		s->bound = *best;
+		evaluate_block(s, cand, first, last);
+		store_block(s, first, last);
+		if(s->budget)
+			count_block(s, first, last);
+		/* scan in index order, ties go to the lowest index */
+		for(i = first; i < last; i++)
+			if(s->scores[i] < *best) {
+				*best = s->scores[i];
+				found = i;
+				if(policy == FIRST_IMPROVEMENT)
+					break;
+			}
+	}
+
+	return found;
+}
+
+void
+sweep_free(Sweep *s) {
+	int i;
+
+	g_mutex_lock(&s->lock);
+	s->quit = 1;
+	g_cond_broadcast(&s->start);
+	g_mutex_unlock(&s->lock);
+	for(i=1; i<s->n; i++)
+		g_thread_join(s->threads[i]);
+	g_mutex_clear(&s->lock);
+	g_cond_clear(&s->start);
+	g_cond_clear(&s->done);
+	free(s->threads);
+	free(s->scores);
+	free(s->hashes);
+	free(s->known);
+	free(s);
+}
@@ -0,0 +1,78 @@
+/*
+ * Description: sweep.h, header file for sweep.c
+ */
+
+#include <signal.h>
+#include <glib.h>
+
+/* acceptance policies */
+#define FIRST_IMPROVEMENT	0
+#define BEST_IMPROVEMENT	1
+
+/* candidates scored per thread before looking for a first improvement */
+#define SWEEP_BLOCK	8
+
+/* why a budgeted search stopped */
+#define STOP_NONE	0
+#define STOP_TIME	1
+#define STOP_EVALS	2
+#define STOP_SIGNAL	3
+
+/* structs */
+typedef struct {
+	int a;
+	int b;
+} Swap;
+
+/*
+ * score the current key with positions a and b swapped, lower is better;
+ * a score not below bound loses anyway, any value from bound up will do
+ */
+typedef double (*ScoreFunc)(void *ctx, int a, int b, double bound);
+
+/* limits of an anytime search, zero means unbounded */
+typedef struct Budget {
+	gint64 deadline;
+	long max_evals;
+	long evals;
+	int stopped;
+} Budget;
+
+typedef struct {
+	int n;
+	ScoreFunc score;
+	void **ctx;
+	GThread **threads;
+	GMutex lock;
+	GCond start;
+	GCond done;
+	int generation;
+	int pending;
+	int quit;
+	/* block currently being evaluated */
+	Swap *cand;
+	int first;
+	int last;
+	double bound;
+	double *scores;
+	int size;
+	/* optional score cache, key is the permutation the swaps apply to */
+	struct Cache *cache;
+	const char *key;
+	guint64 *hashes;
+	char *known;
+	Budget *budget;
+} Sweep;
+
+/* function declarations */
+void budget_begin(Budget *b, double seconds, long max_evals);
+int budget_exhausted(Budget *b);
+const char *budget_reason(Budget *b);
+void budget_end(Budget *b);
+int neighbourhood(Swap *cand, int keysize);
+int drop_locked(Swap *cand, int ncand, const char *locked);
+Sweep *sweep_new(int n, ScoreFunc score, void **ctx);
+void sweep_budget(Sweep *s, Budget *b);
+void sweep_cache(Sweep *s, struct Cache *cache, const char *key);
+int sweep_run(Sweep *s, Swap *cand, int ncand, int policy, double current, double *best);
+void sweep_free(Sweep *s);
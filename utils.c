@@ -138,13 +138,45 @@ count_trigrams(FILE *fi, GList *l, int case_sensitive, int alpha_only) {
         return l;
 }
 
+/* a word of count_words() and the time it got to its count */
+typedef struct {
+        Word *w;
+        long t;
+} Tally;
+
+static int
+by_tally(const void *x, const void *y) {
+        const Tally *a = *(Tally * const *)x, *b = *(Tally * const *)y;
+
+        if(a->w->occ != b->w->occ)
+                return a->w->occ < b->w->occ ? 1 : -1;
+        return a->t < b->t ? -1 : a->t > b->t;
+}
+
+/*
+ * the words by decreasing occurrences, ties in the order they got to their
+ * count, as bubbling every word up the list gave; words are found in a
+ * hash table and sorted once at the end
+ */
 GList *
 count_words(FILE *fi, GList *l, int case_sensitive) {
         char buf[N], c;
-        Word *tmp = NULL;
-        GList *iter = NULL;
+        Tally *tmp, **all;
+        GHashTable *seen;
+        GHashTableIter it;
+        gpointer k, v;
+        GList *iter;
+        long t = 0, n = 0;
         int i;
 
+        seen = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free);
+        for(iter = g_list_first(l); iter != NULL; iter = iter->next) {
+                tmp = malloc(sizeof(Tally));
+                tmp->w = iter->data;
+                tmp->t = t++;
+                g_hash_table_insert(seen, tmp->w->word, tmp);
+        }
+        g_list_free(g_list_first(l));
         rewind(fi);
         while(1) {
                 i = 0;
@@ -161,67 +193,260 @@ count_words(FILE *fi, GList *l, int case_sensitive) {
                 }
                 if(i) {
                         buf[i] = '\0';
-                        iter = g_list_first(l);
-
-                        while(iter != NULL) {
-                                if(strcmp(((Word *)iter->data)->word, buf) == 0) {
-                                        /* word already in l */
-                                        ((Word *)iter->data)->occ += 1;
-                                        while(iter->prev != NULL && ((Word *)iter->prev->data)->occ < ((Word *)iter->data)->occ)
-                                                bubble_up(iter->prev->prev, iter->prev, iter, iter->next);
-                                        break;
-                                }
-                                iter = iter->next;
-                        }
-                        if(iter == NULL) {
+                        if((tmp = g_hash_table_lookup(seen, buf)) == NULL) {
                                 /* this is a new word */
-                                tmp = malloc(sizeof(Word));
-                                strcpy(tmp->word, buf);
-                                tmp->occ = 1;
-                                l = g_list_append(l, tmp);
+                                tmp = malloc(sizeof(Tally));
+                                tmp->w = malloc(sizeof(Word));
+                                strcpy(tmp->w->word, buf);
+                                tmp->w->occ = 0;
+                                g_hash_table_insert(seen, tmp->w->word, tmp);
                         }
+                        tmp->w->occ += 1;
+                        tmp->t = t++;
                 }
         }
+        all = malloc((g_hash_table_size(seen) + 1) * sizeof(Tally *));
+        g_hash_table_iter_init(&it, seen);
+        while(g_hash_table_iter_next(&it, &k, &v))
+                all[n++] = v;
+        qsort(all, n, sizeof(Tally *), by_tally);
+        for(l = NULL; n > 0; n--)
+                l = g_list_prepend(l, all[n-1]->w);
+        free(all);
+        g_hash_table_destroy(seen);
 
         return l;
 }
 
+Writer *
+writer_new(FILE *f) {
+        Writer *w;
+
+        w = malloc(sizeof(Writer));
+        w->len = 0;
+        w->f = f;
+
+        return w;
+}
+
 void
-print_bigrams(GList *l) {
+writer_put(Writer *w, const char *s, size_t n) {
+        if(w->len + n > WRITER_SIZE) {
+                fwrite(w->buf, 1, w->len, w->f);
+                w->len = 0;
+        }
+        if(n > WRITER_SIZE) {
+                fwrite(s, 1, n, w->f);
+                return;
+        }
+        memcpy(w->buf + w->len, s, n);
+        w->len += n;
+}
+
+void
+writer_int(Writer *w, long v, int width) {
+        char tmp[32];
+        int i = sizeof(tmp), neg = v < 0;
+        unsigned long u = neg ? -(unsigned long)v : (unsigned long)v;
+
+        /* right aligned like printf("%*ld") */
+        do {
+                tmp[--i] = '0' + u % 10;
+                u /= 10;
+        } while(u > 0);
+        if(neg)
+                tmp[--i] = '-';
+        while((int)sizeof(tmp) - i < width)
+                tmp[--i] = ' ';
+        writer_put(w, tmp + i, sizeof(tmp) - i);
+}
+
+void
+writer_free(Writer *w) {
+        fwrite(w->buf, 1, w->len, w->f);
+        fflush(w->f);
+        free(w);
+}
+
+/* more occurrences first, then the order they were counted in */
+static int
+better(const Entry *a, const Entry *b) {
+        if(a->occ != b->occ)
+                return a->occ > b->occ;
+        return a->order < b->order;
+}
+
+static int
+by_rank(const void *x, const void *y) {
+        return better(x, y) ? -1 : (better(y, x) ? 1 : 0);
+}
+
+static void
+sift_down(Entry *h, int n, int i) {
+        Entry t;
+        int c;
+
+        /* min-heap, the worst entry kept so far sits on top */
+        while((c = 2*i + 1) < n) {
+                if(c+1 < n && better(&h[c], &h[c+1]))
+                        c++;
+                if(!better(&h[i], &h[c]))
+                        break;
+                t = h[i];
+                h[i] = h[c];
+                h[c] = t;
+                i = c;
+        }
+}
+
+long
+select_top(Entry *e, long n, int top) {
+        long i;
+        int j;
+
+        if(top <= 0 || top >= n) {
+                qsort(e, n, sizeof(Entry), by_rank);
+                return n;
+        }
+        /* the first top entries of e become a heap of the best seen so far */
+        for(j = top/2 - 1; j >= 0; j--)
+                sift_down(e, top, j);
+        for(i = top; i < n; i++)
+                if(better(&e[i], &e[0])) {
+                        e[0] = e[i];
+                        sift_down(e, top, 0);
+                }
+        qsort(e, top, sizeof(Entry), by_rank);
+
+        return top;
+}
+
+static void
+put_escaped(Writer *w, const char *s, int n, int format) {
+        char tmp[8];
+        unsigned char c;
+        int i;
+
+        for(i = 0; i < n; i++) {
+                c = (unsigned char)s[i];
+                /* json gets plain ascii only, every other byte as \u00XX */
+                if(format == FORMAT_TEXT || (c >= 0x20 && c != '\\' && c != '"' && (c < 0x80 || format != FORMAT_JSON))) {
+                        writer_put(w, s+i, 1);
+                        continue;
+                }
+                switch(c) {
+                        case '\n':
+                                writer_put(w, "\\n", 2);
+                                break;
+                        case '\t':
+                                writer_put(w, "\\t", 2);
+                                break;
+                        case '\\':
+                                writer_put(w, "\\\\", 2);
+                                break;
+                        case '"':
+                                if(format == FORMAT_JSON)
+                                        writer_put(w, "\\\"", 2);
+                                else
+                                        writer_put(w, "\"", 1);
+                                break;
+                        default:
+                                snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+                                writer_put(w, tmp, 6);
+                }
+        }
+}
+
+void
+print_report(Entry *e, long n, int top, int format) {
+        Writer *w;
+        long i;
+
+        n = select_top(e, n, top);
+        w = writer_new(stdout);
+        if(format == FORMAT_JSON)
+                writer_put(w, "[\n", 2);
+        for(i = 0; i < n; i++) {
+                switch(format) {
+                        case FORMAT_TSV:
+                                put_escaped(w, e[i].word ? e[i].word : e[i].gram, e[i].len, format);
+                                writer_put(w, "\t", 1);
+                                writer_int(w, e[i].occ, 0);
+                                writer_put(w, "\n", 1);
+                                break;
+                        case FORMAT_JSON:
+                                writer_put(w, "  {\"item\": \"", 12);
+                                put_escaped(w, e[i].word ? e[i].word : e[i].gram, e[i].len, format);
+                                writer_put(w, "\", \"count\": ", 12);
+                                writer_int(w, e[i].occ, 0);
+                                writer_put(w, i+1 < n ? "},\n" : "}\n", i+1 < n ? 3 : 2);
+                                break;
+                        default:
+                                writer_int(w, e[i].occ, 8);
+                                writer_put(w, " : ", 3);
+                                put_escaped(w, e[i].word ? e[i].word : e[i].gram, e[i].len, format);
+                                writer_put(w, "\n", 1);
+                }
+        }
+        if(format == FORMAT_JSON)
+                writer_put(w, "]\n", 2);
+        writer_free(w);
+}
+
+void
+print_bigrams(GList *l, int top, int format) {
         GList *iter = g_list_first(l);
+        Entry *e;
+        long n = 0;
 
-        while(iter != NULL) {
-                printf("%8d : %c%c\n",
-                        ((Bigram *)iter->data)->occ,
-                        ((Bigram *)iter->data)->bigram[0],
-                        ((Bigram *)iter->data)->bigram[1]);
-                iter = iter->next;
+        e = malloc((g_list_length(iter) + 1) * sizeof(Entry));
+        for(; iter != NULL; iter = iter->next, n++) {
+                e[n].word = NULL;
+                e[n].gram[0] = ((Bigram *)iter->data)->bigram[0];
+                e[n].gram[1] = ((Bigram *)iter->data)->bigram[1];
+                e[n].len = 2;
+                e[n].occ = ((Bigram *)iter->data)->occ;
+                e[n].order = n;
         }
+        print_report(e, n, top, format);
+        free(e);
 }
 
 void
-print_trigrams(GList *l) {
+print_trigrams(GList *l, int top, int format) {
         GList *iter = g_list_first(l);
+        Entry *e;
+        long n = 0;
 
-        while(iter != NULL) {
-                printf("%8d : %c%c%c\n",
-                        ((Trigram *)iter->data)->occ,
-                        ((Trigram *)iter->data)->trigram[0],
-                        ((Trigram *)iter->data)->trigram[1],
-                        ((Trigram *)iter->data)->trigram[2]);
-                iter = iter->next;
+        e = malloc((g_list_length(iter) + 1) * sizeof(Entry));
+        for(; iter != NULL; iter = iter->next, n++) {
+                e[n].word = NULL;
+                e[n].gram[0] = ((Trigram *)iter->data)->trigram[0];
+                e[n].gram[1] = ((Trigram *)iter->data)->trigram[1];
+                e[n].gram[2] = ((Trigram *)iter->data)->trigram[2];
+                e[n].len = 3;
+                e[n].occ = ((Trigram *)iter->data)->occ;
+                e[n].order = n;
         }
+        print_report(e, n, top, format);
+        free(e);
 }
 
 void
-print_words(GList *l) {
+print_words(GList *l, int top, int format) {
         GList *iter = g_list_first(l);
+        Entry *e;
+        long n = 0;
 
-        while(iter != NULL) {
-                printf("%8d : ", ((Word *)iter->data)->occ);
-                printf("%s\n", ((Word *)iter->data)->word);
-                iter = iter->next;
+        e = malloc((g_list_length(iter) + 1) * sizeof(Entry));
+        for(; iter != NULL; iter = iter->next, n++) {
+                e[n].word = ((Word *)iter->data)->word;
+                e[n].len = strlen(e[n].word);
+                e[n].occ = ((Word *)iter->data)->occ;
+                e[n].order = n;
         }
+        print_report(e, n, top, format);
+        free(e);
 }
 
 void
@@ -6,6 +6,14 @@
 
 #define	N	256
 
+/* report formats */
+#define FORMAT_TEXT	0
+#define FORMAT_TSV	1
+#define FORMAT_JSON	2
+
+/* size of the report output buffer */
+#define WRITER_SIZE	(1 << 20)
+
 /* structs */
 typedef struct {
         int bigram[2];
@@ -22,11 +30,32 @@ typedef struct {
         int occ;
 } Word;
 
+typedef struct {
+        const char *word;
+        char gram[3];
+        int len;
+        int occ;
+        long order;
+} Entry;
+
+typedef struct {
+        char buf[WRITER_SIZE];
+        size_t len;
+        FILE *f;
+} Writer;
+
 /* function declarations */
+void die(const char *error);
 void bubble_up(GList *a, GList *b, GList *x, GList *c);
-void print_bigrams(GList *l);
-void print_trigrams(GList *l);
-void print_words(GList *l);
+Writer *writer_new(FILE *f);
+void writer_put(Writer *w, const char *s, size_t n);
+void writer_int(Writer *w, long v, int width);
+void writer_free(Writer *w);
+long select_top(Entry *e, long n, int top);
+void print_report(Entry *e, long n, int top, int format);
+void print_bigrams(GList *l, int top, int format);
+void print_trigrams(GList *l, int top, int format);
+void print_words(GList *l, int top, int format);
 void free_list(GList *l);
 GList *count_bigrams(FILE *fi, GList *l, int case_sensitive, int alpha_only);
 GList *count_trigrams(FILE *fi, GList *l, int case_sensitive, int alpha_only);
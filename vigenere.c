@@ -0,0 +1,511 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: vigenere.c, periodic polyalphabetic ciphers. The period is
+ * 		estimated from the index of coincidence, every column is then
+ * 		solved as a shift or as a substitution alphabet and the result
+ * 		is refined with the n-gram scoring of decrypt.c.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "utils.h"
+#include "sweep.h"
+#include "detect.h"
+#include "counts.h"
+#include "vigenere.h"
+
+typedef struct {
+	Periodic *v;
+	double freq[KEYSIZE];
+	int id;
+	int nthreads;
+} ColumnJob;
+
+/* function implementations */
+Periodic *
+periodic_from_buffer(char *text, long len) {
+	Periodic *v;
+	long i;
+
+	v = malloc(sizeof(Periodic));
+	v->text = text;
+	v->len = len;
+	v->nletters = 0;
+	v->sample = len;
+	for(i=0; i<len; i++) {
+		if(isupper((unsigned char)text[i]))
+			text[i] = tolower((unsigned char)text[i]);
+		if(islower((unsigned char)text[i]) && ++v->nletters == PERIODIC_SAMPLE)
+			v->sample = i+1;
+	}
+	v->period = 1;
+	v->shift_only = 1;
+	v->alpha = NULL;
+	v->model = NULL;
+
+	return v;
+}
+
+Periodic *
+periodic_new(FILE *fi) {
+	char *text = NULL;
+	long len = 0, size = 0;
+	size_t n;
+
+	/* a single buffered pass, every later stage works in memory */
+	rewind(fi);
+	do {
+		if(len == size) {
+			size = size ? size*2 : 65536;
+			text = realloc(text, size);
+		}
+		n = fread(text+len, 1, size-len, fi);
+		len += n;
+	} while(n > 0);
+
+	return periodic_from_buffer(text, len);
+}
+
+void
+periodic_free(Periodic *v) {
+	free(v->text);
+	free(v->alpha);
+	free(v);
+}
+
+double
+period_ioc(Periodic *v, int p) {
+	long occ[MAXPERIOD][KEYSIZE], n[MAXPERIOD];
+	double ioc = 0;
+	long i, k = 0;
+	int j;
+
+	memset(occ, 0, sizeof(occ));
+	memset(n, 0, sizeof(n));
+	for(i=0; i<v->len; i++)
+		if(islower((unsigned char)v->text[i])) {
+			occ[k % p][v->text[i]-OFFSET]++;
+			n[k % p]++;
+			k++;
+		}
+	/* average index of coincidence of the columns */
+	for(k=0; k<p; k++)
+		for(j=0; j<KEYSIZE; j++)
+			if(n[k] > 1)
+				ioc += (double)occ[k][j] * (occ[k][j]-1) / ((double)n[k] * (n[k]-1)) / p;
+
+	return ioc;
+}
+
+void
+kasiski(Periodic *v, long k[MAXPERIOD+1]) {
+	long *last, i, j = 0, d;
+	int t = 0, c, p;
+
+	/* distances between repeated trigrams, counted by the periods dividing them */
+	last = malloc(KEYSIZE*KEYSIZE*KEYSIZE * sizeof(long));
+	for(i=0; i<KEYSIZE*KEYSIZE*KEYSIZE; i++)
+		last[i] = -1;
+	for(p=0; p<=MAXPERIOD; p++)
+		k[p] = 0;
+	for(i=0; i<v->len; i++) {
+		if(!islower((unsigned char)v->text[i]))
+			continue;
+		c = v->text[i]-OFFSET;
+		t = (t*KEYSIZE + c) % (KEYSIZE*KEYSIZE*KEYSIZE);
+		if(++j < 3)
+			continue;
+		if(last[t] >= 0) {
+			d = j - last[t];
+			for(p=2; p<=MAXPERIOD; p++)
+				if(d % p == 0)
+					k[p]++;
+		}
+		last[t] = j;
+	}
+	free(last);
+}
+
+static double
+model_ioc(Model *m) {
+	double n = 0, ioc = 0, u;
+	int i, j;
+
+	/* letter counts are the row sums of the bigram counts */
+	for(i=0; i<KEYSIZE; i++)
+		for(j=0; j<KEYSIZE; j++)
+			n += m->b[i][j];
+	for(i=0; i<KEYSIZE; i++) {
+		for(u=0, j=0; j<KEYSIZE; j++)
+			u += m->b[i][j];
+		ioc += n > 1 ? u * (u-1) / (n * (n-1)) : 0;
+	}
+
+	return ioc;
+}
+
+int
+estimate_period(Periodic *v, double ioc_model, int verbose) {
+	double ioc[MAXPERIOD+1], max = 0, threshold;
+	long k[MAXPERIOD+1];
+	int p, last, best = 1;
+
+	last = MAXPERIOD;
+	/* every column needs a few letters for its statistics to mean anything */
+	while(last > 1 && v->nletters / last < 20)
+		last--;
+	for(p=1; p<=last; p++) {
+		ioc[p] = period_ioc(v, p);
+		if(ioc[p] > max)
+			max = ioc[p];
+	}
+	/*
+	 * multiples of the period look as good, take the shortest one close
+	 * to both the language and the best period found
+	 */
+	threshold = (ioc_model + IOC_RANDOM) / 2;
+	if(threshold < 0.9 * max || max < threshold)
+		threshold = 0.9 * max;
+	for(p=1; p<=last; p++)
+		if(ioc[p] >= threshold) {
+			best = p;
+			break;
+		}
+	if(verbose) {
+		kasiski(v, k);
+		printf("%15s | %15s | %15s |\n%s\n", "Period", "Column IoC", "Kasiski",
+			"-----------------------------------------------------");
+		for(p=1; p<=last; p++)
+			printf("%15d | %15.5f | %15ld |%s\n", p, ioc[p], p > 1 ? k[p] : 0, p == best ? " <-" : "");
+		putchar('\n');
+	}
+
+	return best;
+}
+
+static gpointer
+column_worker(gpointer data) {
+	ColumnJob *j = data;
+	Periodic *v = j->v;
+	long occ[KEYSIZE], i, k, n;
+	double chi, min, e;
+	int col, s, x, y, c, max, order[KEYSIZE];
+
+	for(col=j->id; col<v->period; col+=j->nthreads) {
+		memset(occ, 0, sizeof(occ));
+		for(i=0, k=0, n=0; i<v->len; i++)
+			if(islower((unsigned char)v->text[i]) && k++ % v->period == col) {
+				occ[v->text[i]-OFFSET]++;
+				n++;
+			}
+		if(v->shift_only) {
+			/* the shift whose plaintext fits the model letter frequencies best */
+			for(min=HUGE_VAL, s=0, y=0; s<KEYSIZE; s++) {
+				for(chi=0, x=0; x<KEYSIZE; x++) {
+					e = n * j->freq[x];
+					if(e > 0)
+						chi += (occ[(x+s) % KEYSIZE] - e) * (occ[(x+s) % KEYSIZE] - e) / e;
+				}
+				if(chi < min) {
+					min = chi;
+					y = s;
+				}
+			}
+			for(c=0; c<KEYSIZE; c++)
+				v->alpha[col][c] = (c - y + KEYSIZE) % KEYSIZE + OFFSET;
+			continue;
+		}
+		/* same frequency ordering as guess_key(), matched to the model one */
+		for(x=0; x<KEYSIZE; x++) {
+			for(max=-1, y=0, c=0; c<KEYSIZE; c++)
+				if(occ[c] >= max) {
+					max = occ[c];
+					y = c;
+				}
+			occ[y] = -1;
+			order[x] = y;
+		}
+		for(x=0; x<KEYSIZE; x++)
+			v->alpha[col][order[x]] = v->model->ks[x];
+	}
+
+	return NULL;
+}
+
+void
+solve_columns(Periodic *v, int nthreads) {
+	ColumnJob *jobs;
+	GThread **threads;
+	double n = 0, u[KEYSIZE];
+	int i, j;
+
+	free(v->alpha);
+	v->alpha = malloc(v->period * sizeof(*v->alpha));
+	for(i=0; i<KEYSIZE; i++) {
+		for(u[i]=0, j=0; j<KEYSIZE; j++)
+			u[i] += v->model->b[i][j];
+		n += u[i];
+	}
+	if(nthreads < 1)
+		nthreads = 1;
+	if(nthreads > v->period)
+		nthreads = v->period;
+	/* columns are independent of each other */
+	jobs = malloc(nthreads * sizeof(ColumnJob));
+	threads = malloc(nthreads * sizeof(GThread *));
+	for(i=0; i<nthreads; i++) {
+		jobs[i].v = v;
+		for(j=0; j<KEYSIZE; j++)
+			jobs[i].freq[j] = n > 0 ? u[j] / n : 0;
+		jobs[i].id = i;
+		jobs[i].nthreads = nthreads;
+		threads[i] = g_thread_new("column", column_worker, &jobs[i]);
+	}
+	for(i=0; i<nthreads; i++)
+		g_thread_join(threads[i]);
+	free(threads);
+	free(jobs);
+}
+
+void
+periodic_plain(Periodic *v, char (*alpha)[KEYSIZE], char *out, long len) {
+	long i, k = 0;
+
+	for(i=0; i<len; i++)
+		if(islower((unsigned char)v->text[i]))
+			out[i] = alpha[k++ % v->period][v->text[i]-OFFSET];
+		else
+			out[i] = v->text[i];
+}
+
+static double
+column_score(void *ctx, int a, int b, double bound) {
+	Column *c = ctx;
+	Periodic *v = c->v;
+	char t;
+	int col, x;
+	double score;
+
+	/* a shift candidate is (column, shift), a substitution one two letters of a column */
+	col = v->shift_only ? a : a / KEYSIZE;
+	memcpy(c->alpha, v->alpha, v->period * sizeof(*v->alpha));
+	if(v->shift_only)
+		for(x=0; x<KEYSIZE; x++)
+			c->alpha[col][x] = (x - b + KEYSIZE) % KEYSIZE + OFFSET;
+	else {
+		t = c->alpha[col][a % KEYSIZE];
+		c->alpha[col][a % KEYSIZE] = c->alpha[col][b % KEYSIZE];
+		c->alpha[col][b % KEYSIZE] = t;
+	}
+	periodic_plain(v, c->alpha, c->plain, v->sample);
+	state_load_buffer(c->state, c->plain, v->sample);
+	score = state_bounded_goodness(c->state, bound);
+
+	return score;
+}
+
+double
+refine_columns(Periodic *v, Search *search) {
+	Column **ctx;
+	Sweep *sw;
+	Swap *cand;
+	Budget budget;
+	double score, best;
+	int i, j, n, x, y, ncand = 0;
+	char t;
+
+	n = search->threads < 1 ? 1 : search->threads;
+	ctx = malloc(n * sizeof(Column *));
+	for(i=0; i<n; i++) {
+		ctx[i] = malloc(sizeof(Column));
+		ctx[i]->v = v;
+		ctx[i]->state = state_new(v->model, NULL);
+		ctx[i]->plain = malloc(v->sample);
+		ctx[i]->alpha = malloc(v->period * sizeof(*v->alpha));
+	}
+	cand = malloc(v->period * KEYSIZE*KEYSIZE * sizeof(Swap));
+	for(i=0; i<v->period; i++)
+		if(v->shift_only)
+			for(j=0; j<KEYSIZE; j++) {
+				cand[ncand].a = i;
+				cand[ncand++].b = j;
+			}
+		else
+			for(x=0; x<KEYSIZE; x++)
+				for(y=x+1; y<KEYSIZE; y++) {
+					cand[ncand].a = i*KEYSIZE + x;
+					cand[ncand++].b = i*KEYSIZE + y;
+				}
+	periodic_plain(v, v->alpha, ctx[0]->plain, v->sample);
+	state_load_buffer(ctx[0]->state, ctx[0]->plain, v->sample);
+	score = state_goodness(ctx[0]->state);
+	sw = sweep_new(n, column_score, (void **)ctx);
+	budget_begin(&budget, search->time_limit, search->max_evals);
+	sweep_budget(sw, &budget);
+	while((j = sweep_run(sw, cand, ncand, search->policy, score, &best)) >= 0) {
+		score = best;
+		i = v->shift_only ? cand[j].a : cand[j].a / KEYSIZE;
+		if(v->shift_only)
+			for(x=0; x<KEYSIZE; x++)
+				v->alpha[i][x] = (x - cand[j].b + KEYSIZE) % KEYSIZE + OFFSET;
+		else {
+			t = v->alpha[i][cand[j].a % KEYSIZE];
+			v->alpha[i][cand[j].a % KEYSIZE] = v->alpha[i][cand[j].b % KEYSIZE];
+			v->alpha[i][cand[j].b % KEYSIZE] = t;
+		}
+	}
+	if(budget.stopped)
+		printf("\rstopped, %s after %ld evaluations, n-gram score %f\n", budget_reason(&budget), budget.evals, score);
+	budget_end(&budget);
+	sweep_free(sw);
+	for(i=0; i<n; i++) {
+		state_free(ctx[i]->state);
+		free(ctx[i]->plain);
+		free(ctx[i]->alpha);
+		free(ctx[i]);
+	}
+	free(ctx);
+	free(cand);
+	state_pool_clear();
+
+	return score;
+}
+
+static void
+print_periodic(Periodic *v) {
+	char *plain;
+	int i;
+
+	printf("\rdone!\n\nThe key found is:\n\n");
+	if(v->shift_only) {
+		printf("\t");
+		for(i=0; i<v->period; i++)
+			putchar((KEYSIZE - (v->alpha[i][0]-OFFSET)) % KEYSIZE + OFFSET);
+		putchar('\n');
+	}
+	else
+		for(i=0; i<v->period; i++) {
+			printf("\t%3d -> ", i);
+			print_key(v->alpha[i]);
+		}
+	printf("\nDecryption result:\n\n");
+	plain = malloc(v->len);
+	periodic_plain(v, v->alpha, plain, v->len);
+	fwrite(plain, 1, v->len, stdout);
+	free(plain);
+	putchar('\n');
+}
+
+void
+periodic_decrypt(FILE *fi, FILE *fs, Search *search, int shift_only, int period) {
+	Periodic *v;
+	Model *model;
+
+	model = model_new(fs);
+	v = periodic_new(fi);
+	v->model = model;
+	v->shift_only = shift_only;
+	printf("Estimating the period...\n\n");
+	v->period = estimate_period(v, model_ioc(model), 1);
+	if(period > 0)
+		v->period = period;
+	printf("Solving %d %s alphabets...\n", v->period, shift_only ? "shift" : "substitution");
+	solve_columns(v, search->threads);
+	refine_columns(v, search);
+	print_periodic(v);
+	periodic_free(v);
+	model_free(model);
+}
+
+static int
+by_name(const void *x, const void *y) {
+	return strcmp(*(char * const *)x, *(char * const *)y);
+}
+
+void
+bench_periodic(FILE *fs, const char *spec, Search *search) {
+	int periods[] = {3, 5, 7, 11};
+	const gchar *name;
+	char **files = NULL, **model_files, *plain, *cipher;
+	char key[MAXPERIOD];
+	Periodic *v, *sample;
+	Model *model;
+	FILE *f;
+	GRand *rand;
+	GDir *d;
+	gint64 start;
+	double secs, ok;
+	long i, k;
+	int n = 0, j, p, found;
+
+	if((d = g_dir_open(SAMPLES_DIR, 0, NULL)) == NULL) {
+		fprintf(stderr, "Samples directory not found.\n");
+		return;
+	}
+	/* the model would score its own text */
+	model_files = sample_files(spec);
+	while((name = g_dir_read_name(d)) != NULL) {
+		files = realloc(files, (n+1) * sizeof(char *));
+		files[n] = g_build_filename(SAMPLES_DIR, name, NULL);
+		if(in_model(model_files, files[n]))
+			g_free(files[n]);
+		else
+			n++;
+	}
+	g_dir_close(d);
+	g_strfreev(model_files);
+	qsort(files, n, sizeof(char *), by_name);
+	model = model_new(fs);
+	/* synthetic keys, the same on every run */
+	rand = g_rand_new_with_seed(1);
+	printf("%-24s | %6s | %6s | %10s | %10s | %10s |\n%s\n", "Sample", "Period", "Found",
+		"Symbols", "Seconds", "MB/s",
+		"---------------------------------------------------------------------------------");
+	for(j=0; j<n; j++) {
+		if((f = fopen(files[j], "r")) == NULL)
+			continue;
+		sample = periodic_new(f);
+		fclose(f);
+		for(p=0; p<(int)(sizeof(periods)/sizeof(int)); p++) {
+			for(i=0; i<periods[p]; i++)
+				key[i] = g_rand_int_range(rand, 0, KEYSIZE);
+			cipher = malloc(sample->len);
+			for(i=0, k=0; i<sample->len; i++)
+				if(islower((unsigned char)sample->text[i]))
+					cipher[i] = (sample->text[i]-OFFSET + key[k++ % periods[p]]) % KEYSIZE + OFFSET;
+				else
+					cipher[i] = sample->text[i];
+			v = periodic_from_buffer(cipher, sample->len);
+			v->model = model;
+			start = g_get_monotonic_time();
+			v->period = estimate_period(v, model_ioc(model), 0);
+			solve_columns(v, search->threads);
+			refine_columns(v, search);
+			secs = (g_get_monotonic_time() - start) / 1e6;
+			found = v->period;
+			plain = malloc(v->len);
+			periodic_plain(v, v->alpha, plain, v->len);
+			for(i=0, ok=0; i<v->len; i++)
+				if(islower((unsigned char)sample->text[i]) && plain[i] == sample->text[i])
+					ok++;
+			printf("%-24s | %6d | %6d | %9.2f%% | %10.3f | %10.2f |\n", files[j], periods[p], found,
+				sample->nletters ? 100 * ok / sample->nletters : 0, secs,
+				secs > 0 ? sample->len / secs / (1 << 20) : 0);
+			free(plain);
+			periodic_free(v);
+		}
+		periodic_free(sample);
+	}
+	g_rand_free(rand);
+	model_free(model);
+	for(j=0; j<n; j++)
+		g_free(files[j]);
+	free(files);
+}
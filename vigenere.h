@@ -0,0 +1,48 @@
+/*
+ * Description: vigenere.h, header file for vigenere.c
+ */
+
+#include <glib.h>
+
+/* longest period tried when estimating it */
+#define MAXPERIOD	32
+/* letters of the ciphertext used by the n-gram refinement */
+#define PERIODIC_SAMPLE	65536
+/* kinds of periodic alphabets */
+#define SHIFT_ALPHABETS		1
+#define SUBSTITUTION_ALPHABETS	2
+
+/* index of coincidence of random text */
+#define IOC_RANDOM	(1.0/KEYSIZE)
+
+/* structs */
+typedef struct {
+	char *text;
+	long len;
+	long nletters;
+	long sample;
+	int period;
+	int shift_only;
+	char (*alpha)[KEYSIZE];
+	Model *model;
+} Periodic;
+
+typedef struct {
+	Periodic *v;
+	State *state;
+	char *plain;
+	char (*alpha)[KEYSIZE];
+} Column;
+
+/* function declarations */
+Periodic *periodic_new(FILE *fi);
+Periodic *periodic_from_buffer(char *text, long len);
+void periodic_free(Periodic *v);
+double period_ioc(Periodic *v, int p);
+void kasiski(Periodic *v, long k[MAXPERIOD+1]);
+int estimate_period(Periodic *v, double ioc_model, int verbose);
+void solve_columns(Periodic *v, int nthreads);
+double refine_columns(Periodic *v, Search *search);
+void periodic_plain(Periodic *v, char (*alpha)[KEYSIZE], char *out, long len);
+void periodic_decrypt(FILE *fi, FILE *fs, Search *search, int shift_only, int period);
+void bench_periodic(FILE *fs, const char *sample, Search *search);
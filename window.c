@@ -0,0 +1,198 @@
+/*
+ * Author:      Marco Squarcina <lavish@gmail.com>
+ * Date:        19/10/2026
+ * Version:     0.6
+ * License:     MIT, see LICENSE for details
+ * Description: window.c, sliding window letter and bigram statistics. Two
+ * 		adjacent windows slide over the text, updated in constant
+ * 		time per letter, and their divergence peaks where the key
+ * 		changes.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decrypt.h"
+#include "window.h"
+
+/* function implementations */
+Window *
+window_new(int size) {
+	Window *w;
+
+	w = calloc(1, sizeof(Window));
+	w->size = size;
+	w->ring = malloc(2 * size * sizeof(int));
+	w->offset = malloc(2 * size * sizeof(long));
+
+	return w;
+}
+
+void
+window_free(Window *w) {
+	free(w->ring);
+	free(w->offset);
+	free(w);
+}
+
+/* letter number i of the stream, it must still be in the ring */
+static int
+at(Window *w, long i) {
+	return w->ring[i % (2 * w->size)];
+}
+
+static void
+fill(Window *w) {
+	long i;
+	int h;
+
+	for(i=0; i<2*w->size; i++) {
+		h = i >= w->size;
+		w->f[h][at(w, i)]++;
+		if(i % w->size > 0)
+			w->b[h][at(w, i-1)][at(w, i)]++;
+	}
+}
+
+/* add a letter, returns 1 once both halves are full */
+int
+window_push(Window *w, int c, long offset) {
+	long n = w->size, h = w->head;
+	int o, m;
+
+	if(h < 2*n) {
+		w->ring[h] = c;
+		w->offset[h] = offset;
+		w->head++;
+		if(w->head == 2*n)
+			fill(w);
+		return w->head == 2*n;
+	}
+	/* o leaves the left half, m crosses from the right one to the left */
+	o = at(w, h-2*n);
+	m = at(w, h-n);
+	w->f[0][o]--;
+	w->b[0][o][at(w, h-2*n+1)]--;
+	w->f[0][m]++;
+	w->b[0][at(w, h-n-1)][m]++;
+	w->f[1][m]--;
+	w->b[1][m][at(w, h-n+1)]--;
+	w->f[1][c]++;
+	w->b[1][at(w, h-1)][c]++;
+	w->ring[h % (2*n)] = c;
+	w->offset[h % (2*n)] = offset;
+	w->head++;
+
+	return 1;
+}
+
+double
+js_divergence(guint32 *p, guint32 *q, int n) {
+	double np = 0, nq = 0, x, y, mid, d = 0;
+	int i;
+
+	for(i=0; i<n; i++) {
+		np += p[i];
+		nq += q[i];
+	}
+	if(np == 0 || nq == 0)
+		return 0;
+	/* Jensen-Shannon, in bits, 0 for equal and 1 for disjoint histograms */
+	for(i=0; i<n; i++) {
+		x = p[i] / np;
+		y = q[i] / nq;
+		mid = (x + y) / 2;
+		if(x > 0)
+			d += x * log2(x / mid) / 2;
+		if(y > 0)
+			d += y * log2(y / mid) / 2;
+	}
+
+	return d;
+}
+
+static int
+by_value(const void *x, const void *y) {
+	double a = *(const double *)x, b = *(const double *)y;
+
+	return a < b ? -1 : a > b;
+}
+
+int
+find_splits(Score *s, int n, int step, int size, long *split) {
+	double *d, threshold;
+	int i, best, nsplit = 0;
+
+	if(n == 0)
+		return 0;
+	d = malloc(n * sizeof(double));
+	for(i=0; i<n; i++)
+		d[i] = s[i].unigram;
+	qsort(d, n, sizeof(double), by_value);
+	threshold = WINDOW_PEAK * d[n/2];
+	if(threshold < WINDOW_FLOOR)
+		threshold = WINDOW_FLOOR;
+	free(d);
+	/* the highest score of every run above the threshold is a split */
+	for(i=0; i<n; ) {
+		if(s[i].unigram < threshold) {
+			i++;
+			continue;
+		}
+		best = i;
+		/* runs closer than a window belong to the same shift */
+		for(; i<n && (s[i].unigram >= threshold || (long)(i - best) * step < size); i++)
+			if(s[i].unigram > s[best].unigram)
+				best = i;
+		split[nsplit++] = s[best].offset;
+	}
+
+	return nsplit;
+}
+
+void
+window_analysis(FILE *fi, int size) {
+	Window *w;
+	Score *s = NULL;
+	long *split, offset = 0, last = 0;
+	int c, i, n = 0, alloc = 0, step, nsplit;
+
+	w = window_new(size);
+	step = size / 4 > 0 ? size / 4 : 1;
+	rewind(fi);
+	while((c = fgetc(fi)) != EOF) {
+		if(isalpha(c) && window_push(w, tolower(c) - OFFSET, offset) && (w->head - 2*size) % step == 0) {
+			if(n == alloc) {
+				alloc = alloc ? 2 * alloc : 256;
+				s = realloc(s, alloc * sizeof(Score));
+			}
+			/* the boundary is the first letter of the right half */
+			s[n].offset = w->offset[(w->head - size) % (2*size)];
+			s[n].unigram = js_divergence(w->f[0], w->f[1], KEYSIZE);
+			s[n].bigram = js_divergence(&w->b[0][0][0], &w->b[1][0][0], KEYSIZE*KEYSIZE);
+			n++;
+		}
+		offset++;
+	}
+
+	printf("Sliding window analysis, %d letters per half window:\n\n", size);
+	printf("%12s | %12s | %12s |\n%s\n", "Offset", "Divergence", "Bigram div.",
+		"--------------------------------------------");
+	for(i=0; i<n; i++)
+		printf("%12ld | %12.6f | %12.6f |\n", s[i].offset, s[i].unigram, s[i].bigram);
+	if(n == 0)
+		printf("The input is shorter than two windows.\n");
+	split = malloc((n + 1) * sizeof(long));
+	nsplit = find_splits(s, n, step, size, split);
+	printf("\nSegments, split at %d points:\n\n", nsplit);
+	for(i=0; i<nsplit; i++) {
+		printf("\t%ld-%ld\n", last, split[i]);
+		last = split[i];
+	}
+	printf("\t%ld-%ld\n\n", last, offset);
+	free(split);
+	free(s);
+	window_free(w);
+}
@@ -0,0 +1,38 @@
+/*
+ * Description: window.h, header file for window.c
+ */
+
+#include <glib.h>
+
+/* letters per half window, at least */
+#define WINDOW_MIN	16
+/* a split is a divergence peak this many times above the median */
+#define WINDOW_PEAK	3.0
+/* and above this floor, in bits */
+#define WINDOW_FLOOR	0.05
+
+/* structs */
+typedef struct {
+	int size;
+	/* the last 2*size letters and their byte offsets */
+	int *ring;
+	long *offset;
+	long head;
+	/* counts of the left (0) and right (1) half */
+	guint32 f[2][KEYSIZE];
+	guint32 b[2][KEYSIZE][KEYSIZE];
+} Window;
+
+typedef struct {
+	long offset;
+	double unigram;
+	double bigram;
+} Score;
+
+/* function declarations */
+Window *window_new(int size);
+void window_free(Window *w);
+int window_push(Window *w, int c, long offset);
+double js_divergence(guint32 *p, guint32 *q, int n);
+int find_splits(Score *s, int n, int step, int size, long *split);
+void window_analysis(FILE *fi, int size);